@@ -0,0 +1,103 @@
+#include "ai_driver.h"
+
+#include <cmath>
+
+
+const std::vector<Waypoint> TRACK_WAYPOINTS = {
+        {417, 109}, {667, 109}, {717, 172}, {717, 438}, {667, 516},
+        {562, 538}, {492, 500}, {479, 344}, {458, 256}, {375, 231},
+        {292, 256}, {279, 344}, {279, 469}, {250, 525}, {167, 538},
+        {92, 500}, {83, 344}, {83, 172}, {146, 109}, {250, 109}
+};
+
+namespace {
+
+//Distance in pixels at which a waypoint counts as reached
+constexpr double WAYPOINT_RADIUS = 45.;
+//Sine of the heading error below which the car drives straight
+constexpr double STEER_DEADZONE = 0.05;
+//Above this speed the car brakes for waypoints more than about 45 degrees off its heading
+constexpr double CORNER_SPEED = 60.;
+constexpr double CORNER_COSINE = 0.7;
+//Cars per chunk of the decision pass
+constexpr size_t DECIDE_GRAIN = 256;
+
+}
+
+
+AiDrivers::AiDrivers(std::vector<Waypoint> waypoints, size_t firstCar, WorkerPool* pool)
+    : waypoints(std::move(waypoints)), firstCar(firstCar), pool(pool) {}
+
+uint32_t AiDrivers::closestWaypointAhead(const OrientedBox& box) const {
+    uint32_t closest = 0;
+    double closestDistance = INFINITY;
+    for (uint32_t i = 0; i < waypoints.size(); i++) {
+        double dx = waypoints[i].x - box.centerX;
+        double dy = waypoints[i].y - box.centerY;
+        double distance = dx * dx + dy * dy;
+        if (distance < closestDistance) {
+            closestDistance = distance;
+            closest = i;
+        }
+    }
+    //Skip it when it is already behind the car
+    double dx = waypoints[closest].x - box.centerX;
+    double dy = waypoints[closest].y - box.centerY;
+    if (dx * box.axisX + dy * box.axisY < 0) closest = (closest + 1) % waypoints.size();
+    return closest;
+}
+
+void AiDrivers::decide(Simulation& simulation, size_t begin, size_t end) {
+    const CarPool& cars = simulation.getCars();
+    for (size_t i = begin; i < end; i++) {
+        OrientedBox box = cars.getBox(firstCar + i);
+
+        uint32_t target = targets[i];
+        double dx = waypoints[target].x - box.centerX;
+        double dy = waypoints[target].y - box.centerY;
+        if (dx * dx + dy * dy < WAYPOINT_RADIUS * WAYPOINT_RADIUS) {
+            target = (target + 1) % waypoints.size();
+            targets[i] = target;
+            dx = waypoints[target].x - box.centerX;
+            dy = waypoints[target].y - box.centerY;
+        }
+
+        //Heading error from the cross and dot product; positive cross means the
+        //waypoint is to the right, which is where turnRight rotates the car
+        double distance = std::sqrt(dx * dx + dy * dy);
+        double inverse = distance > 0 ? 1.0 / distance : 0.0;
+        double sine = (box.axisX * dy - box.axisY * dx) * inverse;
+        double cosine = (box.axisX * dx + box.axisY * dy) * inverse;
+
+        double velocityX = cars.getVelocityX(firstCar + i);
+        double velocityY = cars.getVelocityY(firstCar + i);
+        double speed2 = velocityX * velocityX + velocityY * velocityY;
+
+        CarInput input;
+        bool steer = cosine < 0 || std::fabs(sine) > STEER_DEADZONE;
+        input.turnRight = steer && sine >= 0;
+        input.turnLeft = steer && sine < 0;
+        input.decelerate = cosine < CORNER_COSINE && speed2 > CORNER_SPEED * CORNER_SPEED;
+        input.accelerate = !input.decelerate;
+        simulation.setInput(firstCar + i, input);
+    }
+}
+
+void AiDrivers::drive(Simulation& simulation) {
+    const CarPool& cars = simulation.getCars();
+    if (cars.size() <= firstCar || waypoints.empty()) return;
+
+    size_t count = cars.size() - firstCar;
+    while (targets.size() < count) {
+        targets.push_back(closestWaypointAhead(cars.getBox(firstCar + targets.size())));
+    }
+
+    //Each car only touches its own target and input, so chunks never share data
+    if (pool) {
+        pool->parallelFor(count, DECIDE_GRAIN, [this, &simulation](size_t begin, size_t end) {
+            decide(simulation, begin, end);
+        });
+    } else {
+        decide(simulation, 0, count);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef MYGAME_AI_DRIVER_H
+#define MYGAME_AI_DRIVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "simulation.h"
+#include "worker_pool.h"
+
+
+struct Waypoint {
+    double x;
+    double y;
+};
+
+//Racing line around track.bmp in window pixels, in driving order starting at the finish line
+extern const std::vector<Waypoint> TRACK_WAYPOINTS;
+
+//Drives cars along a loop of waypoints with the same controls a player has. Each car
+//decides on its own from its position, heading and speed, so the decision pass is split
+//into chunks that run on the worker pool.
+class AiDrivers {
+
+private:
+    std::vector<Waypoint> waypoints;
+    size_t firstCar;
+    WorkerPool* pool;
+    //Waypoint each car is heading for, indexed from firstCar
+    std::vector<uint32_t> targets;
+
+    uint32_t closestWaypointAhead(const OrientedBox& box) const;
+    void decide(Simulation& simulation, size_t begin, size_t end);
+
+public:
+
+    //Cars before firstCar are left to the players. Without a pool everything runs on the caller.
+    AiDrivers(std::vector<Waypoint> waypoints, size_t firstCar, WorkerPool* pool = nullptr);
+
+    //Sets the inputs of every AI car for the next tick
+    void drive(Simulation& simulation);
+};
+
+#endif //MYGAME_AI_DRIVER_H
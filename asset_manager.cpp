@@ -0,0 +1,161 @@
+#include "asset_manager.h"
+
+#include <iostream>
+
+
+AssetManager::AssetManager(SDL_Renderer* renderer) : renderer(renderer) {
+    worker = std::thread(&AssetManager::decodeLoop, this);
+}
+
+AssetManager::~AssetManager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+
+    for (DecodedImage& image : decoded) {
+        if (image.surface) SDL_FreeSurface(image.surface);
+    }
+    for (auto& entry : textures) {
+        if (entry.second->texture) SDL_DestroyTexture(entry.second->texture);
+    }
+}
+
+void AssetManager::decodeLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !decodeQueue.empty(); });
+        if (stopping) return;
+        std::string path = std::move(decodeQueue.front());
+        decodeQueue.pop_front();
+
+        //File I/O and decoding happen without the lock so the render thread never waits on them
+        lock.unlock();
+        SDL_Surface* surface = SDL_LoadBMP(path.c_str());
+        if (surface == nullptr) {
+            std::cerr << "Unable to load image " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+        } else {
+            SDL_SetColorKey(surface, SDL_TRUE, SDL_MapRGB(surface->format, 127, 127, 127));
+        }
+        lock.lock();
+
+        decoded.push_back({ std::move(path), surface });
+        decodedReady.notify_all();
+    }
+}
+
+bool AssetManager::mountPack(const std::string& path) {
+    return pack.open(path);
+}
+
+//False when the pack does not have the image and it has to be decoded
+bool AssetManager::createFromPack(TextureAsset& asset) {
+    PackedImage image;
+    if (!pack.find(asset.path, image)) return false;
+
+    //Pack pixels already have the renderer's format and alpha, no conversion needed
+    asset.texture = SDL_CreateTexture(renderer, PACK_PIXEL_FORMAT, SDL_TEXTUREACCESS_STATIC, image.width, image.height);
+    if (asset.texture == nullptr || SDL_UpdateTexture(asset.texture, nullptr, image.pixels, image.pitch) != 0) {
+        std::cerr << "Unable to create texture from " << asset.path << "! SDL Error: " << SDL_GetError() << std::endl;
+        if (asset.texture) SDL_DestroyTexture(asset.texture);
+        asset.texture = nullptr;
+        asset.failed = true;
+        return true;
+    }
+    SDL_SetTextureBlendMode(asset.texture, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+TextureHandle AssetManager::load(const std::string& path) {
+    auto found = textures.find(path);
+    if (found != textures.end()) return found->second;
+
+    auto asset = std::make_shared<TextureAsset>(path);
+    textures.emplace(path, asset);
+    if (createFromPack(*asset)) return asset;
+
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        decodeQueue.push_back(path);
+    }
+    wake.notify_one();
+    return asset;
+}
+
+std::vector<TextureHandle> AssetManager::preload(const std::vector<std::string>& manifest) {
+    std::vector<TextureHandle> handles;
+    handles.reserve(manifest.size());
+    for (const std::string& path : manifest) {
+        handles.push_back(load(path));
+    }
+    return handles;
+}
+
+void AssetManager::upload(std::vector<DecodedImage>& images) {
+    for (DecodedImage& image : images) {
+        pending--;
+        auto found = textures.find(image.path);
+        if (found == textures.end()) {
+            if (image.surface) SDL_FreeSurface(image.surface);
+            continue;
+        }
+
+        TextureAsset& asset = *found->second;
+        if (image.surface) {
+            asset.texture = SDL_CreateTextureFromSurface(renderer, image.surface);
+            if (asset.texture == nullptr) {
+                std::cerr << "Unable to create texture from " << image.path << "! SDL Error: " << SDL_GetError() << std::endl;
+            }
+            SDL_FreeSurface(image.surface);
+        }
+        asset.failed = asset.texture == nullptr;
+    }
+    images.clear();
+}
+
+void AssetManager::update() {
+    if (pending == 0) return;
+    std::vector<DecodedImage> images;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        images.swap(decoded);
+    }
+    upload(images);
+}
+
+bool AssetManager::finishLoading() {
+    std::vector<DecodedImage> images;
+    while (pending > 0) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            decodedReady.wait(lock, [this] { return !decoded.empty(); });
+            images.swap(decoded);
+        }
+        upload(images);
+    }
+
+    for (auto& entry : textures) {
+        if (entry.second->failed) return false;
+    }
+    return true;
+}
+
+size_t AssetManager::collectUnused() {
+    //Images still being decoded are kept, upload() would otherwise have nowhere to put them
+    size_t freed = 0;
+    for (auto it = textures.begin(); it != textures.end();) {
+        const TextureAsset& asset = *it->second;
+        bool inFlight = !asset.texture && !asset.failed;
+        if (it->second.use_count() == 1 && !inFlight) {
+            if (asset.texture) SDL_DestroyTexture(asset.texture);
+            it = textures.erase(it);
+            freed++;
+        } else {
+            ++it;
+        }
+    }
+    return freed;
+}
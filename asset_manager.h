@@ -0,0 +1,107 @@
+#ifndef MYGAME_ASSET_MANAGER_H
+#define MYGAME_ASSET_MANAGER_H
+
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "asset_pack.h"
+
+
+//Texture owned by the AssetManager, null until its image is decoded and uploaded
+class TextureAsset {
+
+    friend class AssetManager;
+
+private:
+    std::string path;
+    SDL_Texture* texture = nullptr;
+    bool failed = false;
+
+public:
+
+    explicit TextureAsset(std::string path) : path(std::move(path)) {}
+
+    SDL_Texture* get() const { return texture; }
+
+    bool isReady() const { return texture != nullptr; }
+
+    //The image could not be read or uploaded, get() stays null
+    bool hasFailed() const { return failed; }
+
+    const std::string& getPath() const { return path; }
+};
+
+//Handles are shared, the texture lives until the last handle is gone and collectUnused runs
+using TextureHandle = std::shared_ptr<const TextureAsset>;
+
+//Texture cache keyed by path. Images found in the mounted pack are created straight from
+//its mapped pixels; other BMPs are decoded on a worker thread and uploaded on the render
+//thread in update(), so requesting a texture never reads a file on the frame path.
+//Every method except the worker itself must be called from the thread that owns the renderer.
+class AssetManager {
+
+private:
+    struct DecodedImage {
+        std::string path;
+        //Null when decoding failed
+        SDL_Surface* surface;
+    };
+
+    SDL_Renderer* renderer;
+    AssetPack pack;
+    std::unordered_map<std::string, std::shared_ptr<TextureAsset>> textures;
+    //Requested but not uploaded yet
+    size_t pending = 0;
+
+    //Shared with the worker thread
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable decodedReady;
+    std::deque<std::string> decodeQueue;
+    std::vector<DecodedImage> decoded;
+    bool stopping = false;
+    std::thread worker;
+
+    void decodeLoop();
+    void upload(std::vector<DecodedImage>& images);
+    bool createFromPack(TextureAsset& asset);
+
+public:
+
+    explicit AssetManager(SDL_Renderer* renderer);
+    ~AssetManager();
+
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+
+    //Maps a pack built by mygame_pack, later loads of the images in it skip decoding
+    bool mountPack(const std::string& path);
+
+    //Cached handle for path, the first request queues the image for decoding
+    TextureHandle load(const std::string& path);
+
+    //Queues every image in the manifest, handles are returned in manifest order
+    std::vector<TextureHandle> preload(const std::vector<std::string>& manifest);
+
+    //Uploads whatever the worker has decoded since the last call, once per frame
+    void update();
+
+    //Blocks until every queued image is uploaded (loading screens), false if any failed
+    bool finishLoading();
+
+    //Destroys textures that no handle refers to anymore, returns how many were freed
+    size_t collectUnused();
+
+    size_t getPendingCount() const { return pending; }
+    size_t getCachedCount() const { return textures.size(); }
+};
+
+#endif //MYGAME_ASSET_MANAGER_H
@@ -0,0 +1,152 @@
+#include "asset_pack.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+
+namespace {
+
+constexpr uint64_t PACK_ALIGNMENT = 16;
+
+//Opaque grey used as the colour key by every sprite
+constexpr Uint32 COLOR_KEY = 0xFF7F7F7F;
+
+uint64_t alignOffset(uint64_t offset) {
+    return (offset + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+}
+
+}
+
+
+bool AssetPack::open(const std::string& path) {
+    close();
+    //A missing pack is not an error, the game falls back to the BMPs
+    if (!file.open(path)) return false;
+    if (!validate(path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool AssetPack::validate(const std::string& path) {
+    const uint8_t* data = file.data();
+    size_t size = file.size();
+    PackHeader header;
+    if (size < sizeof(header)) {
+        std::cerr << "Asset pack " << path << " is truncated" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != PACK_MAGIC || header.version != PACK_VERSION) {
+        std::cerr << "Asset pack " << path << " has an unknown format" << std::endl;
+        return false;
+    }
+    if (header.entryCount > (size - sizeof(header)) / sizeof(PackEntry)) {
+        std::cerr << "Asset pack " << path << " is truncated" << std::endl;
+        return false;
+    }
+
+    //The index sits right after the header, which keeps it aligned for direct access
+    const PackEntry* index = reinterpret_cast<const PackEntry*>(data + sizeof(header));
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        const PackEntry& entry = index[i];
+        uint64_t bytes = static_cast<uint64_t>(entry.pitch) * entry.height;
+        if (entry.pitch < entry.width * 4 || entry.offset > size || bytes > size - entry.offset
+            || entry.name[PACK_NAME_LENGTH - 1] != '\0') {
+            std::cerr << "Asset pack " << path << " has a broken entry" << std::endl;
+            entries.clear();
+            return false;
+        }
+        entries.push_back(&entry);
+    }
+    return true;
+}
+
+void AssetPack::close() {
+    entries.clear();
+    file.close();
+}
+
+bool AssetPack::find(const std::string& name, PackedImage& image) const {
+    for (const PackEntry* entry : entries) {
+        if (name != entry->name) continue;
+        image.width = static_cast<int>(entry->width);
+        image.height = static_cast<int>(entry->height);
+        image.pitch = static_cast<int>(entry->pitch);
+        image.pixels = file.data() + entry->offset;
+        return true;
+    }
+    return false;
+}
+
+
+bool writeAssetPack(const std::string& output, const std::vector<std::string>& paths) {
+    std::vector<PackEntry> entries(paths.size());
+    std::vector<std::vector<Uint32>> images(paths.size());
+    uint64_t offset = alignOffset(sizeof(PackHeader) + sizeof(PackEntry) * paths.size());
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        const std::string& path = paths[i];
+        if (path.size() >= PACK_NAME_LENGTH) {
+            std::cerr << "Image path " << path << " is too long for the pack index" << std::endl;
+            return false;
+        }
+        SDL_Surface* loadedSurface = SDL_LoadBMP(path.c_str());
+        if (loadedSurface == nullptr) {
+            std::cerr << "Unable to load image " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        SDL_Surface* image = SDL_ConvertSurfaceFormat(loadedSurface, PACK_PIXEL_FORMAT, 0);
+        SDL_FreeSurface(loadedSurface);
+        if (image == nullptr) {
+            std::cerr << "Unable to convert image " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+
+        //Keyed pixels become fully transparent black, so filtering never bleeds grey into the edges
+        std::vector<Uint32>& pixels = images[i];
+        pixels.resize(static_cast<size_t>(image->w) * image->h);
+        SDL_LockSurface(image);
+        for (int y = 0; y < image->h; y++) {
+            const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(image->pixels) + y * image->pitch);
+            for (int x = 0; x < image->w; x++) {
+                Uint32 pixel = row[x] | 0xFF000000;
+                pixels[static_cast<size_t>(y) * image->w + x] = pixel == COLOR_KEY ? 0 : pixel;
+            }
+        }
+        SDL_UnlockSurface(image);
+
+        PackEntry& entry = entries[i];
+        std::memset(&entry, 0, sizeof(entry));
+        std::memcpy(entry.name, path.c_str(), path.size());
+        entry.width = static_cast<uint32_t>(image->w);
+        entry.height = static_cast<uint32_t>(image->h);
+        entry.pitch = entry.width * 4;
+        entry.offset = offset;
+        offset = alignOffset(offset + static_cast<uint64_t>(entry.pitch) * entry.height);
+        SDL_FreeSurface(image);
+    }
+
+    std::ofstream file(output, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Unable to write asset pack " << output << std::endl;
+        return false;
+    }
+    PackHeader header = { PACK_MAGIC, PACK_VERSION, static_cast<uint32_t>(paths.size()), 0 };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(sizeof(PackEntry) * entries.size()));
+
+    const char padding[PACK_ALIGNMENT] = {};
+    for (size_t i = 0; i < entries.size(); i++) {
+        uint64_t position = static_cast<uint64_t>(file.tellp());
+        file.write(padding, static_cast<std::streamsize>(entries[i].offset - position));
+        file.write(reinterpret_cast<const char*>(images[i].data()), static_cast<std::streamsize>(images[i].size() * 4));
+    }
+    if (!file) {
+        std::cerr << "Unable to write asset pack " << output << std::endl;
+        return false;
+    }
+    return true;
+}
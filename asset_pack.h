@@ -0,0 +1,75 @@
+#ifndef MYGAME_ASSET_PACK_H
+#define MYGAME_ASSET_PACK_H
+
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+
+//Pack file layout, all fields little endian:
+//  PackHeader, then entryCount PackEntry records, then the pixel data of every
+//  image at 16 byte aligned offsets from the start of the file.
+//Pixels are SDL_PIXELFORMAT_ARGB8888 with the colour key already turned into alpha,
+//so they can be handed to SDL_UpdateTexture as they are.
+constexpr uint32_t PACK_MAGIC = 0x4B50474D; // "MGPK"
+constexpr uint32_t PACK_VERSION = 1;
+constexpr size_t PACK_NAME_LENGTH = 64;
+constexpr Uint32 PACK_PIXEL_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+
+struct PackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+
+struct PackEntry {
+    //Path the image was packed from, e.g. "resources/track.bmp", zero padded
+    char name[PACK_NAME_LENGTH];
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;
+    uint32_t reserved;
+    uint64_t offset;
+};
+
+//Image inside a mapped pack, valid while the pack is open
+struct PackedImage {
+    int width;
+    int height;
+    int pitch;
+    const void* pixels;
+};
+
+//Read only memory mapping of a pack file. Nothing is copied or decoded, the pages
+//are faulted in when a texture is created from them.
+class AssetPack {
+
+private:
+    MappedFile file;
+    std::vector<const PackEntry*> entries;
+
+    bool validate(const std::string& path);
+
+public:
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return file.isOpen(); }
+
+    //Looks up an image by the path it was packed from
+    bool find(const std::string& name, PackedImage& image) const;
+
+    size_t getEntryCount() const { return entries.size(); }
+};
+
+//Converts the BMPs at paths to pack pixels (colour key 127, 127, 127 becomes
+//transparent) and writes them to output. Used by the mygame_pack build tool.
+bool writeAssetPack(const std::string& output, const std::vector<std::string>& paths);
+
+#endif //MYGAME_ASSET_PACK_H
@@ -0,0 +1,72 @@
+#include "background_layer.h"
+#include "profiler.h"
+
+#include <iostream>
+
+
+BackgroundLayer::BackgroundLayer(SDL_Renderer* renderer, SDL_Texture* source)
+    : renderer(renderer), source(source) {}
+
+BackgroundLayer::~BackgroundLayer() {
+    if (cache) SDL_DestroyTexture(cache);
+}
+
+void BackgroundLayer::setSource(SDL_Texture* texture) {
+    if (texture == source) return;
+    source = texture;
+    dirty = true;
+}
+
+bool BackgroundLayer::rebuild(int outputWidth, int outputHeight) {
+    MYGAME_PROFILE_ZONE("Background rebuild");
+    if (cache && (outputWidth != width || outputHeight != height)) {
+        SDL_DestroyTexture(cache);
+        cache = nullptr;
+    }
+    if (cache == nullptr) {
+        cache = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, outputWidth, outputHeight);
+        if (cache == nullptr) {
+            std::cerr << "Unable to create background cache! SDL Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        width = outputWidth;
+        height = outputHeight;
+    }
+
+    SDL_Texture* previous = SDL_GetRenderTarget(renderer);
+    if (SDL_SetRenderTarget(renderer, cache) != 0) {
+        std::cerr << "Unable to draw into background cache! SDL Error: " << SDL_GetError() << std::endl;
+        SDL_DestroyTexture(cache);
+        cache = nullptr;
+        return false;
+    }
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, source, nullptr, nullptr);
+    SDL_SetRenderTarget(renderer, previous);
+    //Opaque, so the copy each frame needs no blending
+    SDL_SetTextureBlendMode(cache, SDL_BLENDMODE_NONE);
+    dirty = false;
+    rebuilds++;
+    return true;
+}
+
+int BackgroundLayer::draw() {
+    int outputWidth = 0;
+    int outputHeight = 0;
+    SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight);
+    if (dirty || cache == nullptr || outputWidth != width || outputHeight != height) {
+        //A failed cache is only retried after the next invalidate, until then the source is stretched
+        if (!dirty && cache == nullptr) {
+            SDL_RenderCopy(renderer, source, nullptr, nullptr);
+            return 1;
+        }
+        if (!rebuild(outputWidth, outputHeight)) {
+            dirty = false;
+            SDL_RenderCopy(renderer, source, nullptr, nullptr);
+            return 1;
+        }
+    }
+    SDL_RenderCopy(renderer, cache, nullptr, nullptr);
+    return 1;
+}
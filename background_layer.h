@@ -0,0 +1,46 @@
+#ifndef MYGAME_BACKGROUND_LAYER_H
+#define MYGAME_BACKGROUND_LAYER_H
+
+#include <SDL2/SDL.h>
+
+
+//The track stretched to the window once and kept in a target texture of the window's size.
+//Each frame is then a plain copy at 1:1 instead of a stretch of the small track image, which
+//on the software renderer is a full SDL_SoftStretch every frame. The cache is rebuilt when
+//the output size, the source texture or the renderer's targets change.
+class BackgroundLayer {
+
+private:
+    SDL_Renderer* renderer;
+    SDL_Texture* source;
+    SDL_Texture* cache = nullptr;
+    int width = 0;
+    int height = 0;
+    bool dirty = true;
+    int rebuilds = 0;
+
+    bool rebuild(int outputWidth, int outputHeight);
+
+public:
+
+    BackgroundLayer(SDL_Renderer* renderer, SDL_Texture* source);
+    ~BackgroundLayer();
+
+    BackgroundLayer(const BackgroundLayer&) = delete;
+    BackgroundLayer& operator=(const BackgroundLayer&) = delete;
+
+    //A different track, rendered into the cache on the next draw
+    void setSource(SDL_Texture* texture);
+
+    //Call on SDL_RENDER_TARGETS_RESET and window size changes
+    void invalidate() { dirty = true; }
+
+    //Covers the whole output, returns the number of render calls. Falls back to stretching
+    //the source when the renderer cannot draw into textures.
+    int draw();
+
+    //Times the cache was filled, once per resize or track change
+    int getRebuilds() const { return rebuilds; }
+};
+
+#endif //MYGAME_BACKGROUND_LAYER_H
@@ -0,0 +1,39 @@
+#include "broadphase.h"
+
+
+void SweepAndPrune::findPairs(const std::vector<SDL_Rect>& boxes, std::vector<CollisionPair>& pairs) {
+    pairs.clear();
+
+    //Boxes added or removed since the last tick invalidate the previous order
+    if (order.size() != boxes.size()) {
+        order.resize(boxes.size());
+        for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    }
+
+    //Insertion sort by left edge
+    for (size_t i = 1; i < order.size(); i++) {
+        uint32_t current = order[i];
+        int left = boxes[current].x;
+        size_t j = i;
+        while (j > 0 && boxes[order[j - 1]].x > left) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = current;
+    }
+
+    //Sweep: only boxes starting before this one ends can overlap it on x
+    for (size_t i = 0; i < order.size(); i++) {
+        const SDL_Rect& a = boxes[order[i]];
+        int right = a.x + a.w;
+        for (size_t j = i + 1; j < order.size(); j++) {
+            const SDL_Rect& b = boxes[order[j]];
+            if (b.x >= right) break;
+            if (b.y < a.y + a.h && a.y < b.y + b.h) {
+                uint32_t first = order[i] < order[j] ? order[i] : order[j];
+                uint32_t second = order[i] < order[j] ? order[j] : order[i];
+                pairs.push_back({ first, second });
+            }
+        }
+    }
+}
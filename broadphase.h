@@ -0,0 +1,32 @@
+#ifndef MYGAME_BROADPHASE_H
+#define MYGAME_BROADPHASE_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <vector>
+
+
+//Two boxes whose bounds overlap, always with a < b
+struct CollisionPair {
+    uint32_t a;
+    uint32_t b;
+};
+
+//Sweep and prune along the x axis. The sort order is kept between ticks, cars
+//barely move per tick so the insertion sort is close to linear in the car count.
+class SweepAndPrune {
+
+private:
+    std::vector<uint32_t> order;
+
+public:
+
+    //Fills pairs with every unique pair of overlapping boxes (same test as SDL_HasIntersection)
+    void findPairs(const std::vector<SDL_Rect>& boxes, std::vector<CollisionPair>& pairs);
+
+    //The order decides the order pairs are reported in, so it is part of a rollback snapshot
+    const std::vector<uint32_t>& getOrder() const { return order; }
+    void setOrder(const std::vector<uint32_t>& previous) { order.assign(previous.begin(), previous.end()); }
+};
+
+#endif //MYGAME_BROADPHASE_H
@@ -0,0 +1,22 @@
+#include "car.h"
+#include "profiler.h"
+
+
+const PhysicsParameters DEFAULT_PHYSICS;
+
+bool drawCar(SDL_Renderer* renderer, const CarSnapshot& car, double alpha, const SDL_Rect& view) {
+    vect_t drawPosition = car.previousPosition + (car.position - car.previousPosition) * alpha;
+    SDL_Rect drawRect = { static_cast<int>(drawPosition.v.x) - view.x, static_cast<int>(drawPosition.v.y) - view.y,
+                          car.width, car.height };
+
+    //Rotated about its centre the sprite stays within a square as wide as its diagonal
+    int reach = (car.width + car.height) / 2;
+    int centerX = drawRect.x + car.width / 2;
+    int centerY = drawRect.y + car.height / 2;
+    if (centerX + reach < 0 || centerY + reach < 0 || centerX - reach > view.w || centerY - reach > view.h) return false;
+
+    double drawAngle = car.previousAngle + (car.angle - car.previousAngle) * alpha;
+    MYGAME_PROFILE_ZONE("SDL_RenderCopyEx");
+    SDL_RenderCopyEx(renderer, car.texture, nullptr, &drawRect, drawAngle, nullptr, SDL_FLIP_NONE);
+    return true;
+}
@@ -0,0 +1,90 @@
+#ifndef MYGAME_CAR_H
+#define MYGAME_CAR_H
+
+#include <SDL2/SDL.h>
+
+#include "obb.h"
+#include "track_map.h"
+
+
+constexpr int WINDOW_WIDTH = 800;
+constexpr int WINDOW_HEIGHT = 600;
+
+//Size of the unrotated car sprite, every car has the same
+constexpr int CAR_WIDTH = 20;
+constexpr int CAR_HEIGHT = 40;
+//Cars start facing right, degrees clockwise from pointing up like SDL_RenderCopyEx
+constexpr double CAR_START_ANGLE = 90.;
+
+constexpr double CAR_ACCELERATION = 50.;
+//Degrees per second, one degree per tick at 60 Hz
+constexpr double CAR_TURN_RATE = 60.;
+//Share of the speed into a wall that bounces back out
+constexpr double WALL_RESTITUTION = 0.5;
+
+//Tunable constants of one race, the defaults are the game's
+struct PhysicsParameters {
+    double acceleration = CAR_ACCELERATION;
+    double turnRate = CAR_TURN_RATE;
+    double wallRestitution = WALL_RESTITUTION;
+    double surfaceDamping[SURFACE_COUNT] = { SURFACE_DAMPING[0], SURFACE_DAMPING[1], SURFACE_DAMPING[2], SURFACE_DAMPING[3] };
+};
+
+extern const PhysicsParameters DEFAULT_PHYSICS;
+
+
+union vect_t {
+    struct { double x; double y;} v;
+};
+
+inline vect_t operator+(const vect_t a, const vect_t b) {
+    vect_t ret = a;
+    ret.v.x += b.v.x;
+    ret.v.y += b.v.y;
+    return ret;
+}
+inline vect_t operator*(const vect_t a, const double b) {
+    vect_t ret = a;
+    ret.v.x *= b;
+    ret.v.y *= b;
+    return ret;
+}
+
+inline vect_t operator-(const vect_t a, const vect_t b) {
+    vect_t ret = a;
+    ret.v.x -= b.v.x;
+    ret.v.y -= b.v.y;
+    return ret;
+}
+
+//What the renderer needs to draw a car, copied out of the simulation after every tick
+struct CarSnapshot {
+    vect_t position;
+    vect_t previousPosition;
+    double angle;
+    double previousAngle;
+    int width;
+    int height;
+    SDL_Texture* texture;
+};
+
+//Draws the car between its previous and current state, alpha in [0, 1], with the top left
+//of the view at the top left of the window. False when the car is outside the view and
+//nothing was drawn.
+bool drawCar(SDL_Renderer* renderer, const CarSnapshot& car, double alpha, const SDL_Rect& view);
+
+//A car on the starting grid, facing right with the top left of its unrotated rect at x, y.
+//Simulation moves it into a CarPool, which does all the racing.
+struct GridCar {
+    int x;
+    int y;
+    //May be null when the car is only simulated (headless mode)
+    SDL_Texture* texture;
+
+    //Where the car is on the grid, the same box CarPool::getBox gives once it races
+    OrientedBox getBox() const {
+        return { x + CAR_WIDTH / 2.0, y + CAR_HEIGHT / 2.0, 1.0, 0.0, CAR_WIDTH / 2.0, CAR_HEIGHT / 2.0 };
+    }
+};
+
+#endif //MYGAME_CAR_H
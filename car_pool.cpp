@@ -0,0 +1,671 @@
+#include "car_pool.h"
+#include "car.h"
+#include "trig.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+
+namespace {
+
+//Everything one integration pass needs, shared by all kernels
+struct IntegrateArgs {
+    double* x;
+    double* y;
+    double* vx;
+    double* vy;
+    const double* hx;
+    const double* hy;
+    const double* throttle;
+    const double* damping;
+    double dt;
+    double halfDt2;
+    double maxX;
+    double maxY;
+};
+
+void integrateScalar(const IntegrateArgs& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        double ax = a.throttle[i] * a.hx[i];
+        double ay = a.throttle[i] * a.hy[i];
+
+        double x = a.x[i] + a.vx[i] * a.dt + ax * a.halfDt2;
+        double y = a.y[i] + a.vy[i] * a.dt + ay * a.halfDt2;
+        double vx = (a.vx[i] + ax * a.dt) * a.damping[i];
+        double vy = (a.vy[i] + ay * a.dt) * a.damping[i];
+
+        //World bounds, the car bounces straight back
+        if (x < 0) { x = 0; vx = -vx; }
+        if (x > a.maxX) { x = a.maxX; vx = -vx; }
+        if (y < 0) { y = 0; vy = -vy; }
+        if (y > a.maxY) { y = a.maxY; vy = -vy; }
+
+        a.x[i] = x;
+        a.y[i] = y;
+        a.vx[i] = vx;
+        a.vy[i] = vy;
+    }
+}
+
+#if defined(MYGAME_SSE2)
+size_t integrateSSE2(const IntegrateArgs& a, size_t count) {
+    const __m128d dt = _mm_set1_pd(a.dt);
+    const __m128d halfDt2 = _mm_set1_pd(a.halfDt2);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d maxX = _mm_set1_pd(a.maxX);
+    const __m128d maxY = _mm_set1_pd(a.maxY);
+    const __m128d sign = _mm_set1_pd(-0.0);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d t = _mm_loadu_pd(a.throttle + i);
+        __m128d ax = _mm_mul_pd(t, _mm_loadu_pd(a.hx + i));
+        __m128d ay = _mm_mul_pd(t, _mm_loadu_pd(a.hy + i));
+        __m128d vx = _mm_loadu_pd(a.vx + i);
+        __m128d vy = _mm_loadu_pd(a.vy + i);
+
+        __m128d x = _mm_add_pd(_mm_add_pd(_mm_loadu_pd(a.x + i), _mm_mul_pd(vx, dt)), _mm_mul_pd(ax, halfDt2));
+        __m128d y = _mm_add_pd(_mm_add_pd(_mm_loadu_pd(a.y + i), _mm_mul_pd(vy, dt)), _mm_mul_pd(ay, halfDt2));
+        __m128d damping = _mm_loadu_pd(a.damping + i);
+        vx = _mm_mul_pd(_mm_add_pd(vx, _mm_mul_pd(ax, dt)), damping);
+        vy = _mm_mul_pd(_mm_add_pd(vy, _mm_mul_pd(ay, dt)), damping);
+
+        //Branchless bounds: clamp the position and flip the sign of the velocity where it was clamped.
+        //The position goes second so min and max keep it when equal, -0.0 included, like the scalar code.
+        __m128d hitX = _mm_or_pd(_mm_cmplt_pd(x, zero), _mm_cmpgt_pd(x, maxX));
+        __m128d hitY = _mm_or_pd(_mm_cmplt_pd(y, zero), _mm_cmpgt_pd(y, maxY));
+        x = _mm_min_pd(maxX, _mm_max_pd(zero, x));
+        y = _mm_min_pd(maxY, _mm_max_pd(zero, y));
+        vx = _mm_xor_pd(vx, _mm_and_pd(hitX, sign));
+        vy = _mm_xor_pd(vy, _mm_and_pd(hitY, sign));
+
+        _mm_storeu_pd(a.x + i, x);
+        _mm_storeu_pd(a.y + i, y);
+        _mm_storeu_pd(a.vx + i, vx);
+        _mm_storeu_pd(a.vy + i, vy);
+    }
+    return i;
+}
+#endif
+
+#if defined(MYGAME_AVX2)
+MYGAME_TARGET_AVX2
+size_t integrateAVX2(const IntegrateArgs& a, size_t count) {
+    const __m256d dt = _mm256_set1_pd(a.dt);
+    const __m256d halfDt2 = _mm256_set1_pd(a.halfDt2);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d maxX = _mm256_set1_pd(a.maxX);
+    const __m256d maxY = _mm256_set1_pd(a.maxY);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d t = _mm256_loadu_pd(a.throttle + i);
+        __m256d ax = _mm256_mul_pd(t, _mm256_loadu_pd(a.hx + i));
+        __m256d ay = _mm256_mul_pd(t, _mm256_loadu_pd(a.hy + i));
+        __m256d vx = _mm256_loadu_pd(a.vx + i);
+        __m256d vy = _mm256_loadu_pd(a.vy + i);
+
+        __m256d x = _mm256_add_pd(_mm256_add_pd(_mm256_loadu_pd(a.x + i), _mm256_mul_pd(vx, dt)), _mm256_mul_pd(ax, halfDt2));
+        __m256d y = _mm256_add_pd(_mm256_add_pd(_mm256_loadu_pd(a.y + i), _mm256_mul_pd(vy, dt)), _mm256_mul_pd(ay, halfDt2));
+        __m256d damping = _mm256_loadu_pd(a.damping + i);
+        vx = _mm256_mul_pd(_mm256_add_pd(vx, _mm256_mul_pd(ax, dt)), damping);
+        vy = _mm256_mul_pd(_mm256_add_pd(vy, _mm256_mul_pd(ay, dt)), damping);
+
+        __m256d hitX = _mm256_or_pd(_mm256_cmp_pd(x, zero, _CMP_LT_OQ), _mm256_cmp_pd(x, maxX, _CMP_GT_OQ));
+        __m256d hitY = _mm256_or_pd(_mm256_cmp_pd(y, zero, _CMP_LT_OQ), _mm256_cmp_pd(y, maxY, _CMP_GT_OQ));
+        x = _mm256_min_pd(maxX, _mm256_max_pd(zero, x));
+        y = _mm256_min_pd(maxY, _mm256_max_pd(zero, y));
+        vx = _mm256_xor_pd(vx, _mm256_and_pd(hitX, sign));
+        vy = _mm256_xor_pd(vy, _mm256_and_pd(hitY, sign));
+
+        _mm256_storeu_pd(a.x + i, x);
+        _mm256_storeu_pd(a.y + i, y);
+        _mm256_storeu_pd(a.vx + i, vx);
+        _mm256_storeu_pd(a.vy + i, vy);
+    }
+    return i;
+}
+#endif
+
+//The fixed point pass, every value a Q16.16 raw integer
+struct FixedIntegrateArgs {
+    int32_t* x;
+    int32_t* y;
+    int32_t* vx;
+    int32_t* vy;
+    const int32_t* hx;
+    const int32_t* hy;
+    const int32_t* throttle;
+    const int32_t* damping;
+    Fixed dt;
+    Fixed halfDt;
+    Fixed maxX;
+    Fixed maxY;
+};
+
+//x += v dt + a dt dt / 2 is computed as v dt + (a dt) (dt / 2), which keeps dt squared from
+//rounding away to a handful of steps
+void integrateFixedScalar(const FixedIntegrateArgs& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        Fixed t = Fixed::fromRaw(a.throttle[i]);
+        Fixed axDt = t * Fixed::fromRaw(a.hx[i]) * a.dt;
+        Fixed ayDt = t * Fixed::fromRaw(a.hy[i]) * a.dt;
+        Fixed vx = Fixed::fromRaw(a.vx[i]);
+        Fixed vy = Fixed::fromRaw(a.vy[i]);
+
+        Fixed x = Fixed::fromRaw(a.x[i]) + vx * a.dt + axDt * a.halfDt;
+        Fixed y = Fixed::fromRaw(a.y[i]) + vy * a.dt + ayDt * a.halfDt;
+        Fixed damping = Fixed::fromRaw(a.damping[i]);
+        vx = (vx + axDt) * damping;
+        vy = (vy + ayDt) * damping;
+
+        if (x < Fixed()) { x = Fixed(); vx = -vx; }
+        if (x > a.maxX) { x = a.maxX; vx = -vx; }
+        if (y < Fixed()) { y = Fixed(); vy = -vy; }
+        if (y > a.maxY) { y = a.maxY; vy = -vy; }
+
+        a.x[i] = x.raw;
+        a.y[i] = y.raw;
+        a.vx[i] = vx.raw;
+        a.vy[i] = vy.raw;
+    }
+}
+
+#if defined(MYGAME_SSE2)
+//Bits 16 to 47 of the signed 64 bit products, the same bits as Fixed's operator*. SSE2 only
+//multiplies unsigned, so the high halves are corrected for negative factors.
+inline __m128i mulFixedSSE2(__m128i a, __m128i b) {
+    const __m128i low = _mm_set1_epi64x(0xFFFFFFFF);
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    __m128i lo = _mm_or_si128(_mm_and_si128(even, low), _mm_slli_epi64(odd, 32));
+    __m128i hi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_andnot_si128(low, odd));
+    __m128i correction = _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(a, 31), b),
+                                       _mm_and_si128(_mm_srai_epi32(b, 31), a));
+    hi = _mm_sub_epi32(hi, correction);
+    return _mm_or_si128(_mm_srli_epi32(lo, Fixed::FRACTION_BITS), _mm_slli_epi32(hi, 32 - Fixed::FRACTION_BITS));
+}
+
+inline __m128i selectSSE2(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+size_t integrateFixedSSE2(const FixedIntegrateArgs& a, size_t count) {
+    const __m128i dt = _mm_set1_epi32(a.dt.raw);
+    const __m128i halfDt = _mm_set1_epi32(a.halfDt.raw);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i maxX = _mm_set1_epi32(a.maxX.raw);
+    const __m128i maxY = _mm_set1_epi32(a.maxY.raw);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.throttle + i));
+        __m128i axDt = mulFixedSSE2(mulFixedSSE2(t, _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.hx + i))), dt);
+        __m128i ayDt = mulFixedSSE2(mulFixedSSE2(t, _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.hy + i))), dt);
+        __m128i vx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.vx + i));
+        __m128i vy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.vy + i));
+
+        __m128i x = _mm_add_epi32(_mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a.x + i)),
+                                                mulFixedSSE2(vx, dt)), mulFixedSSE2(axDt, halfDt));
+        __m128i y = _mm_add_epi32(_mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a.y + i)),
+                                                mulFixedSSE2(vy, dt)), mulFixedSSE2(ayDt, halfDt));
+        __m128i damping = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.damping + i));
+        vx = mulFixedSSE2(_mm_add_epi32(vx, axDt), damping);
+        vy = mulFixedSSE2(_mm_add_epi32(vy, ayDt), damping);
+
+        //Clamp and negate the velocity where clamped, (v ^ -1) - -1 is -v
+        __m128i belowX = _mm_cmplt_epi32(x, zero);
+        __m128i aboveX = _mm_cmpgt_epi32(x, maxX);
+        __m128i belowY = _mm_cmplt_epi32(y, zero);
+        __m128i aboveY = _mm_cmpgt_epi32(y, maxY);
+        __m128i hitX = _mm_or_si128(belowX, aboveX);
+        __m128i hitY = _mm_or_si128(belowY, aboveY);
+        x = selectSSE2(aboveX, maxX, _mm_andnot_si128(belowX, x));
+        y = selectSSE2(aboveY, maxY, _mm_andnot_si128(belowY, y));
+        vx = _mm_sub_epi32(_mm_xor_si128(vx, hitX), hitX);
+        vy = _mm_sub_epi32(_mm_xor_si128(vy, hitY), hitY);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(a.x + i), x);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(a.y + i), y);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(a.vx + i), vx);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(a.vy + i), vy);
+    }
+    return i;
+}
+#endif
+
+#if defined(MYGAME_AVX2)
+MYGAME_TARGET_AVX2
+inline __m256i mulFixedAVX2(__m256i a, __m256i b) {
+    __m256i even = _mm256_mul_epi32(a, b);
+    __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    return _mm256_blend_epi32(_mm256_srli_epi64(even, Fixed::FRACTION_BITS),
+                              _mm256_slli_epi64(odd, 32 - Fixed::FRACTION_BITS), 0xAA);
+}
+
+MYGAME_TARGET_AVX2
+size_t integrateFixedAVX2(const FixedIntegrateArgs& a, size_t count) {
+    const __m256i dt = _mm256_set1_epi32(a.dt.raw);
+    const __m256i halfDt = _mm256_set1_epi32(a.halfDt.raw);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i maxX = _mm256_set1_epi32(a.maxX.raw);
+    const __m256i maxY = _mm256_set1_epi32(a.maxY.raw);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.throttle + i));
+        __m256i axDt = mulFixedAVX2(mulFixedAVX2(t, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.hx + i))), dt);
+        __m256i ayDt = mulFixedAVX2(mulFixedAVX2(t, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.hy + i))), dt);
+        __m256i vx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.vx + i));
+        __m256i vy = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.vy + i));
+
+        __m256i x = _mm256_add_epi32(_mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.x + i)),
+                                                      mulFixedAVX2(vx, dt)), mulFixedAVX2(axDt, halfDt));
+        __m256i y = _mm256_add_epi32(_mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.y + i)),
+                                                      mulFixedAVX2(vy, dt)), mulFixedAVX2(ayDt, halfDt));
+        __m256i damping = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.damping + i));
+        vx = mulFixedAVX2(_mm256_add_epi32(vx, axDt), damping);
+        vy = mulFixedAVX2(_mm256_add_epi32(vy, ayDt), damping);
+
+        __m256i hitX = _mm256_or_si256(_mm256_cmpgt_epi32(zero, x), _mm256_cmpgt_epi32(x, maxX));
+        __m256i hitY = _mm256_or_si256(_mm256_cmpgt_epi32(zero, y), _mm256_cmpgt_epi32(y, maxY));
+        x = _mm256_min_epi32(_mm256_max_epi32(x, zero), maxX);
+        y = _mm256_min_epi32(_mm256_max_epi32(y, zero), maxY);
+        vx = _mm256_sub_epi32(_mm256_xor_si256(vx, hitX), hitX);
+        vy = _mm256_sub_epi32(_mm256_xor_si256(vy, hitY), hitY);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a.x + i), x);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a.y + i), y);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a.vx + i), vx);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a.vy + i), vy);
+    }
+    return i;
+}
+#endif
+
+//Raw integers of the fixed arrays, Fixed is a single int32_t
+int32_t* rawData(std::vector<Fixed>& values) { return reinterpret_cast<int32_t*>(values.data()); }
+
+//Corners and side midpoints of the car rect, as fractions of its width and height from the centre
+const double BODY_POINTS[6][2] = {
+    {-0.5, -0.5}, {0.5, -0.5}, {-0.5, 0}, {0.5, 0}, {-0.5, 0.5}, {0.5, 0.5}
+};
+const int BODY_POINT_COUNT = 6;
+
+//Body point of the car with its top left at x, y, rotated with the heading the same way
+//SDL_RenderCopyEx rotates the sprite
+vect_t bodyPoint(double x, double y, double headingX, double headingY, int point) {
+    double px = BODY_POINTS[point][0] * CAR_WIDTH;
+    double py = BODY_POINTS[point][1] * CAR_HEIGHT;
+    vect_t result;
+    result.v.x = x + CAR_WIDTH / 2.0 - px * headingY - py * headingX;
+    result.v.y = y + CAR_HEIGHT / 2.0 + px * headingX - py * headingY;
+    return result;
+}
+
+template <typename Scalar>
+void hashValues(uint64_t& hash, const std::vector<Scalar>& values) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values.data());
+    for (size_t i = 0; i < values.size() * sizeof(Scalar); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+}
+
+static_assert(sizeof(Fixed) == sizeof(int32_t), "The fixed kernels treat Fixed arrays as int32_t");
+
+
+template <typename Scalar>
+BasicCarPool<Scalar>::BasicCarPool(const PhysicsParameters& physics) : simdLevel(detectSimdLevel()) {
+    setTrack(nullptr);
+    setPhysics(physics);
+}
+
+template <typename Scalar>
+void BasicCarPool<Scalar>::reserve(size_t count) {
+    for (auto* array : { &positionX, &positionY, &velocityX, &velocityY, &headingX, &headingY, &throttle,
+                         &turnDegrees, &turnSines, &turnCosines, &damping, &previousX, &previousY }) {
+        array->reserve(count);
+    }
+    surfaces.reserve(count);
+    angles.reserve(count);
+    previousAngles.reserve(count);
+}
+
+template <typename Scalar>
+size_t BasicCarPool<Scalar>::addCar(double x, double y, double angle) {
+    positionX.push_back(scalarFromDouble<Scalar>(x));
+    positionY.push_back(scalarFromDouble<Scalar>(y));
+    velocityX.push_back(Scalar());
+    velocityY.push_back(Scalar());
+    Scalar s, c;
+    if constexpr (std::is_same_v<Scalar, Fixed>) {
+        fixedSinCosDegrees(Fixed::fromDouble(angle), s, c);
+    } else {
+        sinCosDegrees(angle, s, c);
+    }
+    headingX.push_back(s);
+    headingY.push_back(-c);
+    throttle.push_back(Scalar());
+    turnDegrees.push_back(Scalar());
+    turnSines.push_back(Scalar());
+    turnCosines.push_back(scalarFromDouble<Scalar>(1.0));
+    surfaces.push_back(Surface::Road);
+    damping.push_back(scalarFromDouble<Scalar>(1.0));
+    previousX.push_back(positionX.back());
+    previousY.push_back(positionY.back());
+    angles.push_back(angle);
+    previousAngles.push_back(angle);
+    return positionX.size() - 1;
+}
+
+template <typename Scalar>
+void BasicCarPool<Scalar>::setTrack(const TrackMap* trackMap) {
+    track = trackMap;
+    int worldWidth = track ? track->getWidth() : WINDOW_WIDTH;
+    int worldHeight = track ? track->getHeight() : WINDOW_HEIGHT;
+    maxX = scalarFromDouble<Scalar>(worldWidth - CAR_WIDTH);
+    maxY = scalarFromDouble<Scalar>(worldHeight - CAR_HEIGHT);
+}
+
+template <typename Scalar>
+void BasicCarPool<Scalar>::setPhysics(const PhysicsParameters& physics) {
+    acceleration = scalarFromDouble<Scalar>(physics.acceleration);
+    braking = scalarFromDouble<Scalar>(-physics.acceleration * 0.8);
+    wallBounce = scalarFromDouble<Scalar>(1.0 + physics.wallRestitution);
+    for (int i = 0; i < SURFACE_COUNT; i++) surfaceDamping[i] = physics.surfaceDamping[i];
+    //The drag per tick is worked out again by the next integrate()
+    dampingStep = 0.0;
+}
+
+template <typename Scalar>
+void BasicCarPool<Scalar>::updateDamping(double dt) {
+    if (dt == dampingStep) return;
+    dampingStep = dt;
+    //The damping is given per 60 Hz tick, scaled so the drag per second does not depend on the tick rate
+    for (int i = 0; i < SURFACE_COUNT; i++) {
+        if constexpr (std::is_same_v<Scalar, Fixed>) {
+            surfaceDampingStep[i] = fixedExp(fixedLog(Fixed::fromDouble(surfaceDamping[i])) * Fixed::fromDouble(dt * 60.0));
+        } else {
+            surfaceDampingStep[i] = std::pow(surfaceDamping[i], dt * 60.0);
+        }
+    }
+}
+
+template <typename Scalar>
+void BasicCarPool<Scalar>::savePreviousState() {
+    previousX = positionX;
+    previousY = positionY;
+    previousAngles = angles;
+}
+
+template <typename Scalar>
+void BasicCarPool<Scalar>::applyTurns() {
+    size_t count = size();
+    if constexpr (std::is_same_v<Scalar, Fixed>) {
+        const Fixed threeHalves = Fixed::fromRaw(Fixed::ONE * 3 / 2);
+        const Fixed half = Fixed::fromRaw(Fixed::ONE / 2);
+        for (size_t i = 0; i < count; i++) {
+            //Headings only change when turned, so the renormalise is skipped with them
+            if (turnDegrees[i] == Fixed()) continue;
+            Fixed s, c;
+            fixedSinCosDegrees(turnDegrees[i], s, c);
+            Fixed hx = headingX[i] * c - headingY[i] * s;
+            Fixed hy = headingY[i] * c + headingX[i] * s;
+            Fixed scale = threeHalves - half * (hx * hx + hy * hy);
+            headingX[i] = hx * scale;
+            headingY[i] = hy * scale;
+            angles[i] += turnDegrees[i].toDouble();
+            turnDegrees[i] = Fixed();
+        }
+    } else {
+        sinCosDegreesBatch(turnDegrees.data(), turnSines.data(), turnCosines.data(), count, simdLevel);
+
+        //Rotate every heading by its turn. One Newton step towards length 1 stops the
+        //rounding error of repeated rotations from stretching the vector.
+        for (size_t i = 0; i < count; i++) {
+            double s = turnSines[i];
+            double c = turnCosines[i];
+            double hx = headingX[i] * c - headingY[i] * s;
+            double hy = headingY[i] * c + headingX[i] * s;
+            double scale = 1.5 - 0.5 * (hx * hx + hy * hy);
+            headingX[i] = hx * scale;
+            headingY[i] = hy * scale;
+            angles[i] += turnDegrees[i];
+            turnDegrees[i] = 0.0;
+        }
+    }
+}
+
+template <typename Scalar>
+void BasicCarPool<Scalar>::integrate(double dt) {
+    applyTurns();
+    updateDamping(dt);
+    size_t count = size();
+    for (size_t i = 0; i < count; i++) {
+        damping[i] = surfaceDampingStep[static_cast<int>(surfaces[i])];
+    }
+    size_t done = 0;
+
+    if constexpr (std::is_same_v<Scalar, Fixed>) {
+        Fixed fixedDt = Fixed::fromDouble(dt);
+        FixedIntegrateArgs args = {
+                rawData(positionX), rawData(positionY), rawData(velocityX), rawData(velocityY),
+                rawData(headingX), rawData(headingY), rawData(throttle), rawData(damping),
+                fixedDt, Fixed::fromRaw(fixedDt.raw / 2), maxX, maxY
+        };
+
+        switch (simdLevel) {
+#if defined(MYGAME_AVX2)
+            case SimdLevel::AVX2:
+                done = integrateFixedAVX2(args, count);
+                break;
+#endif
+#if defined(MYGAME_SSE2)
+            case SimdLevel::SSE2:
+                done = integrateFixedSSE2(args, count);
+                break;
+#endif
+            default:
+                break;
+        }
+        integrateFixedScalar(args, done, count);
+    } else {
+        IntegrateArgs args = {
+                positionX.data(), positionY.data(), velocityX.data(), velocityY.data(),
+                headingX.data(), headingY.data(), throttle.data(), damping.data(),
+                dt, dt * dt * 0.5, maxX, maxY
+        };
+
+        switch (simdLevel) {
+#if defined(MYGAME_AVX2)
+            case SimdLevel::AVX2:
+                done = integrateAVX2(args, count);
+                break;
+#endif
+#if defined(MYGAME_SSE2)
+            case SimdLevel::SSE2:
+                done = integrateSSE2(args, count);
+                break;
+#endif
+            default:
+                break;
+        }
+        //Cars left over after the last full vector
+        integrateScalar(args, done, count);
+    }
+}
+
+template <typename Scalar>
+void BasicCarPool<Scalar>::collideWithTrack() {
+    if (!track) return;
+    for (size_t i = 0; i < size(); i++) {
+        //Swept test first so a fast car or a large dt can't skip over a thin wall
+        sweepAgainstTrack(i);
+        pushOutOfWalls(i);
+        vect_t center = getCenter(i);
+        surfaces[i] = track->surfaceAt(center.v.x, center.v.y);
+    }
+}
+
+//The track is queried in double, only the answers change the car, converted to the scalar
+template <typename Scalar>
+void BasicCarPool<Scalar>::sweepAgainstTrack(size_t car) {
+    Scalar motionX = positionX[car] - previousX[car];
+    Scalar motionY = positionY[car] - previousY[car];
+    if (motionX == Scalar() && motionY == Scalar()) return;
+
+    //Earliest impact of the corners and side midpoints along this tick's motion
+    double startX = scalarToDouble(previousX[car]);
+    double startY = scalarToDouble(previousY[car]);
+    double moveX = scalarToDouble(motionX);
+    double moveY = scalarToDouble(motionY);
+    double firstImpact = 2.0;
+    double normalX = 0.0;
+    double normalY = 0.0;
+    for (int i = 0; i < BODY_POINT_COUNT; i++) {
+        vect_t point = bodyPoint(startX, startY, scalarToDouble(headingX[car]), scalarToDouble(headingY[car]), i);
+        double impact, nx, ny;
+        if (track->sweep(point.v.x, point.v.y, point.v.x + moveX, point.v.y + moveY, impact, nx, ny) && impact < firstImpact) {
+            firstImpact = impact;
+            normalX = nx;
+            normalY = ny;
+        }
+    }
+    if (firstImpact > 1.0) return;
+
+    //Stop just short of the wall and bounce off it; the rest of the tick's motion is dropped
+    double length = std::sqrt(moveX * moveX + moveY * moveY);
+    double backOff = 0.01 / length;
+    Scalar t = scalarFromDouble<Scalar>(firstImpact > backOff ? firstImpact - backOff : 0.0);
+    positionX[car] = previousX[car] + motionX * t;
+    positionY[car] = previousY[car] + motionY * t;
+    bounce(car, scalarFromDouble<Scalar>(normalX), scalarFromDouble<Scalar>(normalY));
+}
+
+template <typename Scalar>
+void BasicCarPool<Scalar>::pushOutOfWalls(size_t car) {
+    //The deepest body point inside a wall decides the response
+    TrackSample deepest = { 0.0, 0.0, 0.0, Surface::Road };
+    for (int i = 0; i < BODY_POINT_COUNT; i++) {
+        vect_t point = bodyPoint(getX(car), getY(car), scalarToDouble(headingX[car]), scalarToDouble(headingY[car]), i);
+        TrackSample sample = track->sample(point.v.x, point.v.y);
+        if (sample.distance < deepest.distance) deepest = sample;
+    }
+    if (deepest.distance >= 0) return;
+
+    positionX[car] -= scalarFromDouble<Scalar>(deepest.normalX * deepest.distance);
+    positionY[car] -= scalarFromDouble<Scalar>(deepest.normalY * deepest.distance);
+    bounce(car, scalarFromDouble<Scalar>(deepest.normalX), scalarFromDouble<Scalar>(deepest.normalY));
+}
+
+//Bounce off a wall with part of the speed into it (half by default, like the old rect walls)
+template <typename Scalar>
+void BasicCarPool<Scalar>::bounce(size_t car, Scalar normalX, Scalar normalY) {
+    Scalar normalSpeed = velocityX[car] * normalX + velocityY[car] * normalY;
+    if (normalSpeed < Scalar()) {
+        velocityX[car] -= wallBounce * normalSpeed * normalX;
+        velocityY[car] -= wallBounce * normalSpeed * normalY;
+    }
+}
+
+template <typename Scalar>
+void BasicCarPool<Scalar>::resolveCollision(size_t a, size_t b, const Contact& contact) {
+    Scalar normalX = scalarFromDouble<Scalar>(contact.normalX);
+    Scalar normalY = scalarFromDouble<Scalar>(contact.normalY);
+
+    //Equal masses: the cars swap the part of their velocity along the normal while approaching
+    Scalar relativeSpeed = (velocityX[b] - velocityX[a]) * normalX + (velocityY[b] - velocityY[a]) * normalY;
+    if (relativeSpeed < Scalar()) {
+        velocityX[a] += relativeSpeed * normalX;
+        velocityY[a] += relativeSpeed * normalY;
+        velocityX[b] -= relativeSpeed * normalX;
+        velocityY[b] -= relativeSpeed * normalY;
+    }
+
+    //Each car moves half the penetration depth out of the other
+    Scalar push = scalarFromDouble<Scalar>(contact.depth * 0.5);
+    positionX[a] -= normalX * push;
+    positionY[a] -= normalY * push;
+    positionX[b] += normalX * push;
+    positionY[b] += normalY * push;
+}
+
+template <typename Scalar>
+void BasicCarPool<Scalar>::stop(size_t car) {
+    velocityX[car] = Scalar();
+    velocityY[car] = Scalar();
+    throttle[car] = Scalar();
+}
+
+template <typename Scalar>
+CarSnapshot BasicCarPool<Scalar>::snapshot(size_t car, SDL_Texture* texture) const {
+    return { { { getX(car), getY(car) } }, { { scalarToDouble(previousX[car]), scalarToDouble(previousY[car]) } },
+             angles[car], previousAngles[car], CAR_WIDTH, CAR_HEIGHT, texture };
+}
+
+template <typename Scalar>
+uint64_t BasicCarPool<Scalar>::checksum() const {
+    uint64_t hash = 14695981039346656037ull;
+    hashValues(hash, positionX);
+    hashValues(hash, positionY);
+    hashValues(hash, velocityX);
+    hashValues(hash, velocityY);
+    hashValues(hash, headingX);
+    hashValues(hash, headingY);
+    return hash;
+}
+
+template class BasicCarPool<double>;
+template class BasicCarPool<Fixed>;
+
+
+template <typename Scalar>
+StressResult runCarPoolStress(size_t cars, uint64_t ticks, double dt, SimdLevel level) {
+    BasicCarPool<Scalar> pool;
+    pool.setSimdLevel(level);
+    pool.reserve(cars);
+
+    uint32_t state = 12345;
+    auto random = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return state >> 16;
+    };
+
+    for (size_t i = 0; i < cars; i++) {
+        pool.addCar(random() % (WINDOW_WIDTH - CAR_WIDTH), random() % (WINDOW_HEIGHT - CAR_HEIGHT), random() % 360);
+        pool.accelerate(i);
+    }
+
+    StressResult result;
+    result.cars = cars;
+    result.ticks = ticks;
+    result.simdLevel = level;
+
+    //Only the integration is timed, controls change for a slice of the field each tick
+    std::chrono::duration<double> elapsed(0);
+    for (uint64_t tick = 0; tick < ticks; tick++) {
+        for (size_t i = tick % 30; i < cars; i += 30) {
+            uint32_t r = random();
+            if (r % 8 == 0) pool.decelerate(i);
+            else pool.accelerate(i);
+            pool.turn(i, static_cast<double>(r % 31) - 15.0);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        pool.integrate(dt);
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+
+    result.seconds = elapsed.count();
+    result.checksum = pool.checksum();
+    return result;
+}
+
+template StressResult runCarPoolStress<double>(size_t, uint64_t, double, SimdLevel);
+template StressResult runCarPoolStress<Fixed>(size_t, uint64_t, double, SimdLevel);
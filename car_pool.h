@@ -0,0 +1,182 @@
+#ifndef MYGAME_CAR_POOL_H
+#define MYGAME_CAR_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "car.h"
+#include "fixed_point.h"
+#include "obb.h"
+#include "simd.h"
+#include "track_map.h"
+
+//Scalars the car physics can run on, converted from the double controls and positions
+template <typename Scalar>
+Scalar scalarFromDouble(double value);
+
+template <>
+inline double scalarFromDouble<double>(double value) { return value; }
+
+template <>
+inline Fixed scalarFromDouble<Fixed>(double value) { return Fixed::fromDouble(value); }
+
+inline double scalarToDouble(double value) { return value; }
+inline double scalarToDouble(Fixed value) { return value.toDouble(); }
+
+//Every car of a race in structure-of-arrays form. Each field lives in its own contiguous
+//array so integrate() can process two (SSE2) or four (AVX2) cars per instruction.
+//Simulation steps its cars through the passes in order: savePreviousState, the controls,
+//integrate, collideWithTrack, then resolveCollision for every touching pair.
+//
+//With Fixed as the scalar the state only changes through integer arithmetic. Wall samples
+//and contact normals are still worked out in double from exact inputs, built without
+//contraction, and rounded to Fixed, so races are bit identical across compilers, machines
+//and SIMD levels; the integer kernels fit four (SSE2) or eight (AVX2) cars in a register.
+template <typename Scalar>
+class BasicCarPool {
+
+private:
+    std::vector<Scalar> positionX;
+    std::vector<Scalar> positionY;
+    std::vector<Scalar> velocityX;
+    std::vector<Scalar> velocityY;
+    //Unit vector the car is facing, (sin, -cos) of the sprite angle
+    std::vector<Scalar> headingX;
+    std::vector<Scalar> headingY;
+    std::vector<Scalar> throttle;
+    //Degrees each car turns before the next integration, applied in one batch
+    std::vector<Scalar> turnDegrees;
+    std::vector<Scalar> turnSines;
+    std::vector<Scalar> turnCosines;
+    //Surface under the centre of each car, its drag is applied by the next integrate()
+    std::vector<Surface> surfaces;
+    std::vector<Scalar> damping;
+    //State at the start of the current tick, the track sweep starts from it and the
+    //renderer interpolates from it
+    std::vector<Scalar> previousX;
+    std::vector<Scalar> previousY;
+    //Only drawn, the physics turns the heading
+    std::vector<double> angles;
+    std::vector<double> previousAngles;
+
+    //Walls and surfaces, null for an empty window
+    const TrackMap* track = nullptr;
+    Scalar maxX;
+    Scalar maxY;
+
+    //PhysicsParameters converted to the scalar
+    Scalar acceleration;
+    Scalar braking;
+    Scalar wallBounce;
+    double surfaceDamping[SURFACE_COUNT];
+    //Drag per tick of every surface for ticks of dampingStep seconds
+    Scalar surfaceDampingStep[SURFACE_COUNT];
+    double dampingStep = 0.0;
+    SimdLevel simdLevel;
+
+    void applyTurns();
+    void updateDamping(double dt);
+    void sweepAgainstTrack(size_t car);
+    void pushOutOfWalls(size_t car);
+    void bounce(size_t car, Scalar normalX, Scalar normalY);
+
+public:
+
+    explicit BasicCarPool(const PhysicsParameters& physics = DEFAULT_PHYSICS);
+
+    //x, y is the top left of the unrotated car rect, angle in degrees like the sprite
+    size_t addCar(double x, double y, double angle = CAR_START_ANGLE);
+
+    size_t size() const { return positionX.size(); }
+
+    void reserve(size_t count);
+
+    //Walls, surfaces and world bounds. Without a track only the window edges stop the cars.
+    void setTrack(const TrackMap* trackMap);
+
+    void setPhysics(const PhysicsParameters& physics);
+
+    //Throttle until the next integrate(), full acceleration, braking or none
+    void accelerate(size_t car) { throttle[car] = acceleration; }
+    void decelerate(size_t car) { throttle[car] = braking; }
+    void coast(size_t car) { throttle[car] = Scalar(); }
+
+    //Positive degrees turn right, negative turn left. Turns add up until the next integrate()
+    void turn(size_t car, double degrees) { turnDegrees[car] += scalarFromDouble<Scalar>(degrees); }
+
+    //Remember where every car starts the tick
+    void savePreviousState();
+
+    //Apply the pending turns and advance every car by dt seconds, with the drag of the
+    //surface each car was on and the world bounds
+    void integrate(double dt);
+
+    //Stops every car at the walls it drove into since savePreviousState and pushes it out
+    //of any it ended up in, then looks up the surface under it
+    void collideWithTrack();
+
+    //Equal masses, the contact normal points from car a to car b
+    void resolveCollision(size_t a, size_t b, const Contact& contact);
+
+    //Used to stop cars after they cross the finish line
+    void stop(size_t car);
+
+    void setSimdLevel(SimdLevel level) { simdLevel = level; }
+    SimdLevel getSimdLevel() const { return simdLevel; }
+
+    double getX(size_t car) const { return scalarToDouble(positionX[car]); }
+    double getY(size_t car) const { return scalarToDouble(positionY[car]); }
+    double getVelocityX(size_t car) const { return scalarToDouble(velocityX[car]); }
+    double getVelocityY(size_t car) const { return scalarToDouble(velocityY[car]); }
+
+    //Centre of the car now and at the start of the tick, lap timing follows the path between them
+    vect_t getCenter(size_t car) const {
+        return { { getX(car) + CAR_WIDTH / 2.0, getY(car) + CAR_HEIGHT / 2.0 } };
+    }
+    vect_t getPreviousCenter(size_t car) const {
+        return { { scalarToDouble(previousX[car]) + CAR_WIDTH / 2.0, scalarToDouble(previousY[car]) + CAR_HEIGHT / 2.0 } };
+    }
+
+    //The car rect rotated by its heading
+    OrientedBox getBox(size_t car) const {
+        return { getX(car) + CAR_WIDTH / 2.0, getY(car) + CAR_HEIGHT / 2.0,
+                 scalarToDouble(headingX[car]), scalarToDouble(headingY[car]), CAR_WIDTH / 2.0, CAR_HEIGHT / 2.0 };
+    }
+
+    CarSnapshot snapshot(size_t car, SDL_Texture* texture) const;
+
+    //FNV-1a over the bytes of every position, velocity and heading
+    uint64_t checksum() const;
+};
+
+extern template class BasicCarPool<double>;
+extern template class BasicCarPool<Fixed>;
+
+//The scalar races run on, chosen at build time with -DMYGAME_FIXED_POINT=ON. Replays and
+//netplay peers only agree with builds that use the same one.
+#if defined(MYGAME_FIXED_POINT)
+using CarPool = BasicCarPool<Fixed>;
+constexpr bool RACE_FIXED_POINT = true;
+#else
+using CarPool = BasicCarPool<double>;
+constexpr bool RACE_FIXED_POINT = false;
+#endif
+
+
+struct StressResult {
+    size_t cars = 0;
+    uint64_t ticks = 0;
+    double seconds = 0.0;
+    SimdLevel simdLevel = SimdLevel::Scalar;
+    uint64_t checksum = 0;
+
+    double millisecondsPerTick() const { return ticks > 0 ? seconds * 1000.0 / ticks : 0.0; }
+};
+
+//Integrates a pool of cars with changing controls for the given number of ticks, without a
+//track so only the integration is measured
+template <typename Scalar>
+StressResult runCarPoolStress(size_t cars, uint64_t ticks, double dt, SimdLevel level);
+
+#endif //MYGAME_CAR_POOL_H
@@ -0,0 +1,151 @@
+#ifndef MYGAME_FIXED_POINT_H
+#define MYGAME_FIXED_POINT_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "trig.h"
+
+
+//Q16.16 fixed point: 16 integer bits, range about +-32768 with steps of 1/65536. Every
+//operation is integer arithmetic, so results are bit identical on any compiler, with any
+//flags and at every SIMD level. Overflow wraps instead of being undefined.
+struct Fixed {
+    static constexpr int FRACTION_BITS = 16;
+    static constexpr int32_t ONE = 1 << FRACTION_BITS;
+
+    int32_t raw = 0;
+
+    static constexpr Fixed fromRaw(int32_t value) {
+        Fixed result;
+        result.raw = value;
+        return result;
+    }
+
+    static constexpr Fixed fromInt(int value) { return fromRaw(value * ONE); }
+
+    //Rounds to the nearest step. Scaling by a power of two and rounding are exact, so this is
+    //deterministic too, but it is meant for setup and controls, not for the physics itself.
+    static Fixed fromDouble(double value) { return fromRaw(static_cast<int32_t>(std::lround(value * ONE))); }
+
+    double toDouble() const { return static_cast<double>(raw) / ONE; }
+};
+
+constexpr Fixed operator+(Fixed a, Fixed b) {
+    return Fixed::fromRaw(static_cast<int32_t>(static_cast<uint32_t>(a.raw) + static_cast<uint32_t>(b.raw)));
+}
+
+constexpr Fixed operator-(Fixed a, Fixed b) {
+    return Fixed::fromRaw(static_cast<int32_t>(static_cast<uint32_t>(a.raw) - static_cast<uint32_t>(b.raw)));
+}
+
+constexpr Fixed operator-(Fixed a) {
+    return Fixed::fromRaw(static_cast<int32_t>(0u - static_cast<uint32_t>(a.raw)));
+}
+
+//Full 64 bit product, rounded towards minus infinity. The SIMD kernels take the same bits.
+constexpr Fixed operator*(Fixed a, Fixed b) {
+    return Fixed::fromRaw(static_cast<int32_t>((static_cast<int64_t>(a.raw) * b.raw) >> Fixed::FRACTION_BITS));
+}
+
+//Division by zero saturates to the largest value of the dividend's sign, 0 / 0 is 0
+constexpr Fixed operator/(Fixed a, Fixed b) {
+    if (b.raw == 0) return Fixed::fromRaw(a.raw > 0 ? INT32_MAX : a.raw < 0 ? INT32_MIN : 0);
+    return Fixed::fromRaw(static_cast<int32_t>(static_cast<int64_t>(a.raw) * Fixed::ONE / b.raw));
+}
+
+constexpr Fixed& operator+=(Fixed& a, Fixed b) { return a = a + b; }
+constexpr Fixed& operator-=(Fixed& a, Fixed b) { return a = a - b; }
+
+constexpr bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+constexpr bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+
+
+//Sine and cosine of every whole degree, rounded from the double table at compile time
+struct FixedSinCosTable {
+    std::array<int32_t, 360> sines{};
+    std::array<int32_t, 360> cosines{};
+};
+
+constexpr int32_t roundToFixed(double value) {
+    return static_cast<int32_t>(value * Fixed::ONE + (value < 0 ? -0.5 : 0.5));
+}
+
+constexpr FixedSinCosTable makeFixedSinCosTable() {
+    FixedSinCosTable table;
+    for (int degree = 0; degree < 360; degree++) {
+        table.sines[degree] = roundToFixed(SIN_COS_TABLE.sines[degree]);
+        table.cosines[degree] = roundToFixed(SIN_COS_TABLE.cosines[degree]);
+    }
+    return table;
+}
+
+constexpr FixedSinCosTable FIXED_SIN_COS_TABLE = makeFixedSinCosTable();
+
+constexpr Fixed FIXED_DEGREES_TO_RADIANS = Fixed::fromRaw(roundToFixed(DEGREES_TO_RADIANS));
+
+//Same scheme as sinCosDegrees: the closest whole degree from the table, then the angle
+//sum identities with short series for the remainder of at most half a degree
+inline void fixedSinCosDegrees(Fixed degrees, Fixed& s, Fixed& c) {
+    int32_t whole = (degrees.raw + Fixed::ONE / 2) >> Fixed::FRACTION_BITS;
+    Fixed r = (degrees - Fixed::fromInt(whole)) * FIXED_DEGREES_TO_RADIANS;
+    Fixed r2 = r * r;
+    Fixed rs = r - r * r2 / Fixed::fromInt(6);
+    Fixed rc = Fixed::fromInt(1) - r2 / Fixed::fromInt(2);
+
+    int index = whole % 360;
+    if (index < 0) index += 360;
+    Fixed ts = Fixed::fromRaw(FIXED_SIN_COS_TABLE.sines[index]);
+    Fixed tc = Fixed::fromRaw(FIXED_SIN_COS_TABLE.cosines[index]);
+    s = ts * rc + tc * rs;
+    c = tc * rc - ts * rs;
+}
+
+//e^x by its series, halving x until it is below one and squaring the result back up
+inline Fixed fixedExp(Fixed x) {
+    int halvings = 0;
+    while (x > Fixed::fromInt(1) || x < Fixed::fromInt(-1)) {
+        x = Fixed::fromRaw(x.raw / 2);
+        halvings++;
+    }
+    Fixed sum = Fixed::fromInt(1);
+    Fixed term = Fixed::fromInt(1);
+    for (int n = 1; n < 16 && term != Fixed(); n++) {
+        term = term * x / Fixed::fromInt(n);
+        sum += term;
+    }
+    for (int i = 0; i < halvings; i++) sum = sum * sum;
+    return sum;
+}
+
+constexpr Fixed FIXED_LN2 = Fixed::fromRaw(roundToFixed(0.69314718055994531));
+
+//Natural logarithm: x = m 2^k with m in [1, 2), then ln m = 2 atanh(z) with
+//z = (m - 1) / (m + 1) <= 1/3 by its series. Zero and below give the smallest value.
+inline Fixed fixedLog(Fixed x) {
+    if (x.raw <= 0) return Fixed::fromRaw(INT32_MIN);
+    int32_t m = x.raw;
+    int k = 0;
+    while (m >= 2 * Fixed::ONE) {
+        m >>= 1;
+        k++;
+    }
+    while (m < Fixed::ONE) {
+        m <<= 1;
+        k--;
+    }
+    Fixed z = (Fixed::fromRaw(m) - Fixed::fromInt(1)) / (Fixed::fromRaw(m) + Fixed::fromInt(1));
+    Fixed z2 = z * z;
+    Fixed sum;
+    Fixed power = z;
+    for (int n = 1; n < 16 && power != Fixed(); n += 2) {
+        sum += power / Fixed::fromInt(n);
+        power = power * z2;
+    }
+    return Fixed::fromInt(k) * FIXED_LN2 + sum + sum;
+}
+
+#endif //MYGAME_FIXED_POINT_H
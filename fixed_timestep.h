@@ -0,0 +1,40 @@
+#ifndef MYGAME_FIXED_TIMESTEP_H
+#define MYGAME_FIXED_TIMESTEP_H
+
+
+//Accumulator that turns variable frame times into a whole number of fixed physics ticks.
+//Frames longer than maxFrameTime are clamped, so a stall slows the game down instead of
+//changing the size or the number of steps the physics sees.
+class FixedTimestep {
+
+private:
+    double step;
+    double maxFrameTime;
+    double accumulator = 0.0;
+
+public:
+
+    explicit FixedTimestep(double rate, double maxFrameTime = 0.25)
+        : step(1.0 / rate), maxFrameTime(maxFrameTime) {}
+
+    //Adds the elapsed frame time and returns how many ticks should be simulated
+    int advance(double frameTime) {
+        if (frameTime > maxFrameTime) frameTime = maxFrameTime;
+        if (frameTime < 0.0) frameTime = 0.0;
+        accumulator += frameTime;
+
+        int ticks = 0;
+        while (accumulator >= step) {
+            accumulator -= step;
+            ticks++;
+        }
+        return ticks;
+    }
+
+    //How far the renderer is between the last two physics states, in [0, 1)
+    double alpha() const { return accumulator / step; }
+
+    double getStep() const { return step; }
+};
+
+#endif //MYGAME_FIXED_TIMESTEP_H
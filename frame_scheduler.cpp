@@ -0,0 +1,161 @@
+#include "frame_scheduler.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+
+namespace {
+
+//Bounds for the part of a wait that is spun instead of slept
+constexpr double MIN_SPIN_MARGIN = 0.0002;
+constexpr double MAX_SPIN_MARGIN = 0.004;
+//How fast the spin margin (per sleep) and the work estimate (per frame) come back down after a spike
+constexpr double MARGIN_DECAY = 0.99;
+constexpr double WORK_DECAY = 0.05;
+//Extra time a low latency frame starts early by, for the present itself
+constexpr double LATENCY_SAFETY = 0.001;
+//Longest sleep between calls of the wait callback
+constexpr double WAIT_SLICE = 0.001;
+//Frames watched before a claimed vsync is believed, and the share of a refresh they must average
+constexpr uint64_t VSYNC_PROBE_FRAMES = 30;
+constexpr double VSYNC_MIN_INTERVAL = 0.75;
+
+}
+
+
+const char* pacingModeName(PacingMode mode) {
+    switch (mode) {
+        case PacingMode::TargetRate: return "target";
+        case PacingMode::LowLatency: return "low-latency";
+        case PacingMode::PowerSave: return "power-save";
+    }
+    return "unknown";
+}
+
+FrameScheduler::FrameScheduler(PacingMode mode, double rate, bool vsync)
+    : mode(mode), vsync(vsync), frequency(SDL_GetPerformanceFrequency()) {
+    refresh = ticks(1.0 / rate);
+    period = mode == PacingMode::PowerSave ? refresh * 2 : refresh;
+}
+
+Uint64 FrameScheduler::lead() const {
+    if (mode == PacingMode::LowLatency) return std::min(ticks(workEstimate + LATENCY_SAFETY), period);
+    //With vsync a power save frame starts one refresh before the vblank it is meant for
+    if (mode == PacingMode::PowerSave && vsync) return refresh;
+    return 0;
+}
+
+void FrameScheduler::waitUntil(Uint64 target, const std::function<void()>& whileWaiting) {
+    MYGAME_PROFILE_ZONE("Frame pacing");
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    //Sleep through most of the wait, power save sleeps through all of it and accepts waking late
+    Uint64 margin = mode == PacingMode::PowerSave ? 0 : ticks(spinMargin);
+    while (target > now + margin) {
+        double request = seconds(target - margin - now);
+        if (whileWaiting) request = std::min(request, WAIT_SLICE);
+        std::this_thread::sleep_for(std::chrono::duration<double>(request));
+        Uint64 after = SDL_GetPerformanceCounter();
+        double slept = seconds(after - now);
+        stats.sleepSeconds += slept;
+        //The margin follows the worst recent oversleep, so the spin starts before the deadline
+        spinMargin = std::clamp(std::max(slept - request + MIN_SPIN_MARGIN, spinMargin * MARGIN_DECAY),
+                                MIN_SPIN_MARGIN, MAX_SPIN_MARGIN);
+        if (whileWaiting) whileWaiting();
+        now = SDL_GetPerformanceCounter();
+    }
+
+    if (mode != PacingMode::PowerSave) {
+        Uint64 spinStart = now;
+        while (now < target) {
+            std::this_thread::yield();
+            now = SDL_GetPerformanceCounter();
+        }
+        stats.spinSeconds += seconds(now - spinStart);
+    }
+
+    double error = now > target ? seconds(now - target) : 0.0;
+    wakeErrorSum += error;
+    stats.maxWakeError = std::max(stats.maxWakeError, error);
+    waits++;
+}
+
+void FrameScheduler::beginFrame(const std::function<void()>& whileWaiting) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (!started) {
+        started = true;
+        frameStart = now;
+        nextSlot = now + period;
+        return;
+    }
+
+    //Vsync already holds the target rate, waiting as well would only add latency. While vsync
+    //is being probed nothing waits, so only the present itself can space the frames out.
+    bool probing = vsync && probeFrames < VSYNC_PROBE_FRAMES;
+    if (!probing && !(vsync && mode == PacingMode::TargetRate)) {
+        Uint64 target = nextSlot - std::min(lead(), nextSlot);
+        if (target > now) waitUntil(target, whileWaiting);
+    }
+    frameStart = SDL_GetPerformanceCounter();
+
+    if (!vsync) {
+        nextSlot += period;
+        //More than a frame behind, start a new grid instead of rushing frames out to catch up
+        if (frameStart + lead() > nextSlot) nextSlot = frameStart + period;
+    }
+}
+
+void FrameScheduler::beginPresent() {
+    presentStart = SDL_GetPerformanceCounter();
+}
+
+void FrameScheduler::endFrame() {
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (presentStart < frameStart) presentStart = now;
+
+    //With vsync the present blocks until the vblank, so only the time up to it is work
+    double work = seconds((vsync ? presentStart : now) - frameStart);
+    workEstimate = work > workEstimate ? work : workEstimate + (work - workEstimate) * WORK_DECAY;
+
+    if (lastPresent != 0) {
+        double interval = seconds(now - lastPresent);
+        intervalSum += interval;
+        intervalSquares += interval * interval;
+        intervals++;
+    }
+    lastPresent = now;
+    stats.frames++;
+
+    if (vsync && probeFrames < VSYNC_PROBE_FRAMES) {
+        if (probeFrames == 0) probeStart = now;
+        probeFrames++;
+        //Presents that return faster than the display refreshes are not waiting for it
+        if (probeFrames == VSYNC_PROBE_FRAMES &&
+            now - probeStart < static_cast<Uint64>((VSYNC_PROBE_FRAMES - 1) * refresh * VSYNC_MIN_INTERVAL)) {
+            vsync = false;
+            nextSlot = now + period;
+            //The unpaced probe frames would only skew the pacing numbers
+            intervalSum = 0.0;
+            intervalSquares = 0.0;
+            intervals = 0;
+            return;
+        }
+    }
+
+    //The present returned just after a vblank, the next one this frame can make is a period away
+    if (vsync) nextSlot = now + period;
+}
+
+FramePacingStats FrameScheduler::getStats() const {
+    FramePacingStats result = stats;
+    if (intervals > 0) {
+        result.meanInterval = intervalSum / intervals;
+        double variance = intervalSquares / intervals - result.meanInterval * result.meanInterval;
+        result.intervalJitter = std::sqrt(std::max(variance, 0.0));
+    }
+    if (waits > 0) result.meanWakeError = wakeErrorSum / waits;
+    return result;
+}
@@ -0,0 +1,96 @@
+#ifndef MYGAME_FRAME_SCHEDULER_H
+#define MYGAME_FRAME_SCHEDULER_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <functional>
+
+
+enum class PacingMode {
+    //Frames on a fixed grid at the target rate, left to vsync when the renderer has it
+    TargetRate,
+    //Frames start as late as the measured frame time allows, so input is read just before present
+    LowLatency,
+    //Half the target rate and only sleeping, never spinning
+    PowerSave
+};
+
+const char* pacingModeName(PacingMode mode);
+
+//How well the scheduler kept its grid, all times in seconds
+struct FramePacingStats {
+    uint64_t frames = 0;
+    //Present to present
+    double meanInterval = 0.0;
+    double intervalJitter = 0.0;
+    //How late the scheduler woke up compared to the time it aimed for
+    double meanWakeError = 0.0;
+    double maxWakeError = 0.0;
+    double sleepSeconds = 0.0;
+    double spinSeconds = 0.0;
+};
+
+//Paces the render loop when presenting does not block on vsync (dummy, offscreen and
+//software drivers) so it does not spin a core drawing frames nobody sees. Waits sleep
+//until shortly before the deadline and spin on SDL_GetPerformanceCounter for the rest;
+//the spin margin follows how late the OS has been waking the thread. Some drivers report
+//vsync without blocking in present, so vsync is only trusted once the first frames have
+//actually come a refresh apart.
+class FrameScheduler {
+
+private:
+    PacingMode mode;
+    bool vsync;
+    Uint64 frequency;
+    //Counter ticks per frame, and per refresh of the display
+    Uint64 period;
+    Uint64 refresh;
+
+    bool started = false;
+    //When the next frame should begin (no vsync) or be presented (vsync)
+    Uint64 nextSlot = 0;
+    Uint64 frameStart = 0;
+    Uint64 presentStart = 0;
+    Uint64 lastPresent = 0;
+    //Present to present time of the first frames while vsync is unconfirmed
+    Uint64 probeStart = 0;
+    uint64_t probeFrames = 0;
+    //Seconds from the start of a frame to its present, follows spikes at once and decays slowly
+    double workEstimate = 0.0;
+    double spinMargin = 0.001;
+
+    FramePacingStats stats;
+    double intervalSum = 0.0;
+    double intervalSquares = 0.0;
+    uint64_t intervals = 0;
+    double wakeErrorSum = 0.0;
+    uint64_t waits = 0;
+
+    double seconds(int64_t ticks) const { return static_cast<double>(ticks) / frequency; }
+    Uint64 ticks(double seconds) const { return static_cast<Uint64>(seconds * frequency); }
+    //Ticks the frame should wake before its slot
+    Uint64 lead() const;
+    void waitUntil(Uint64 target, const std::function<void()>& whileWaiting);
+
+public:
+
+    //rate is the display's refresh rate or the rate to hold without vsync,
+    //vsync whether the renderer claims to present with it
+    FrameScheduler(PacingMode mode, double rate, bool vsync);
+
+    //Call at the top of the frame, before events are read. whileWaiting runs between short
+    //sleeps for the whole wait, so input can be read while the frame is held back.
+    void beginFrame(const std::function<void()>& whileWaiting = nullptr);
+
+    //Call right before SDL_RenderPresent and right after it returns
+    void beginPresent();
+    void endFrame();
+
+    FramePacingStats getStats() const;
+
+    PacingMode getMode() const { return mode; }
+    bool hasVsync() const { return vsync; }
+    double getRate() const { return static_cast<double>(frequency) / period; }
+};
+
+#endif //MYGAME_FRAME_SCHEDULER_H
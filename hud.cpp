@@ -0,0 +1,219 @@
+#include "hud.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+
+namespace {
+
+//5x7 glyphs, one byte per row from the top, bit 4 is the leftmost column.
+//Only the characters the HUD prints, anything else is drawn as a space.
+const char GLYPH_CHARS[] = " 0123456789.:ACDFHIKLMPRSTUW";
+const uint8_t GLYPH_ROWS[][7] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // space
+        {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // 0
+        {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 1
+        {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // 2
+        {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 3
+        {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // 4
+        {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 5
+        {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // 6
+        {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+        {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // 8
+        {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 9
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // .
+        {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // :
+        {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}, // A
+        {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // C
+        {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // D
+        {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // F
+        {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // H
+        {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // I
+        {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+        {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // L
+        {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+        {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // P
+        {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // R
+        {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // S
+        {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+        {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // U
+        {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}  // W
+};
+constexpr int GLYPH_COUNT = sizeof(GLYPH_ROWS) / sizeof(GLYPH_ROWS[0]);
+
+//Atlas cells are 6x8 so glyphs never sample their neighbours, the last cell is solid white
+constexpr int CELL_WIDTH = 6;
+constexpr int CELL_HEIGHT = 8;
+constexpr int ATLAS_WIDTH = (GLYPH_COUNT + 1) * CELL_WIDTH;
+constexpr int ATLAS_HEIGHT = CELL_HEIGHT;
+
+//Screen pixels per font pixel
+constexpr float TEXT_SCALE = 2.0f;
+constexpr float LINE_HEIGHT = 18.0f;
+constexpr float PANEL_X = 8.0f;
+constexpr float PANEL_Y = 8.0f;
+constexpr float PANEL_WIDTH = 280.0f;
+constexpr float GRAPH_HEIGHT = 48.0f;
+//Frame time that fills the graph, 30 FPS
+constexpr double GRAPH_RANGE = 1.0 / 30.0;
+
+constexpr SDL_Color TEXT_COLOR = { 255, 255, 255, 255 };
+constexpr SDL_Color PANEL_COLOR = { 0, 0, 0, 160 };
+constexpr SDL_Color FAST_COLOR = { 80, 220, 80, 255 };
+constexpr SDL_Color SLOW_COLOR = { 240, 200, 40, 255 };
+constexpr SDL_Color MISSED_COLOR = { 240, 60, 60, 255 };
+constexpr SDL_Color TARGET_COLOR = { 255, 255, 255, 96 };
+
+int glyphIndex(char c) {
+    if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+    const char* found = std::strchr(GLYPH_CHARS, c);
+    return found && c != '\0' ? static_cast<int>(found - GLYPH_CHARS) : 0;
+}
+
+}
+
+
+Hud::Hud(SDL_Renderer* renderer) : renderer(renderer) {
+    //Bake the font into white pixels with alpha, text colour comes from the vertices
+    std::vector<Uint32> pixels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+    for (int glyph = 0; glyph < GLYPH_COUNT; glyph++) {
+        for (int row = 0; row < 7; row++) {
+            for (int column = 0; column < 5; column++) {
+                if (GLYPH_ROWS[glyph][row] & (0x10 >> column)) {
+                    pixels[row * ATLAS_WIDTH + glyph * CELL_WIDTH + column] = 0xFFFFFFFF;
+                }
+            }
+        }
+    }
+    for (int row = 0; row < CELL_HEIGHT; row++) {
+        for (int column = 0; column < CELL_WIDTH; column++) {
+            pixels[row * ATLAS_WIDTH + GLYPH_COUNT * CELL_WIDTH + column] = 0xFFFFFFFF;
+        }
+    }
+
+    atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, ATLAS_WIDTH, ATLAS_HEIGHT);
+    if (atlas == nullptr) {
+        std::cerr << "Unable to create HUD font atlas! SDL Error: " << SDL_GetError() << std::endl;
+        return;
+    }
+    SDL_UpdateTexture(atlas, nullptr, pixels.data(), ATLAS_WIDTH * 4);
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureScaleMode(atlas, SDL_ScaleModeNearest);
+
+    //Enough for the graph, the panel and a few lines of text without growing
+    vertices.reserve((HISTORY + 128) * 4);
+    indices.reserve((HISTORY + 128) * 6);
+    sorted.reserve(HISTORY);
+}
+
+Hud::~Hud() {
+    if (atlas) SDL_DestroyTexture(atlas);
+}
+
+void Hud::recordFrame(double seconds) {
+    frameTimes[nextFrame] = seconds;
+    nextFrame = (nextFrame + 1) % HISTORY;
+    if (frameCount < HISTORY) frameCount++;
+}
+
+void Hud::addQuad(float x, float y, float w, float h, float u0, float v0, float u1, float v1, SDL_Color color) {
+    int first = static_cast<int>(vertices.size());
+    vertices.push_back({ { x, y }, color, { u0, v0 } });
+    vertices.push_back({ { x + w, y }, color, { u1, v0 } });
+    vertices.push_back({ { x + w, y + h }, color, { u1, v1 } });
+    vertices.push_back({ { x, y + h }, color, { u0, v1 } });
+    const int corners[6] = { 0, 1, 2, 0, 2, 3 };
+    for (int corner : corners) indices.push_back(first + corner);
+}
+
+void Hud::addSolid(float x, float y, float w, float h, SDL_Color color) {
+    //Centre of the white cell, nearest sampling keeps it exactly white
+    float u = (GLYPH_COUNT * CELL_WIDTH + CELL_WIDTH * 0.5f) / ATLAS_WIDTH;
+    float v = 0.5f;
+    addQuad(x, y, w, h, u, v, u, v, color);
+}
+
+void Hud::addText(float x, float y, const char* text, SDL_Color color) {
+    for (const char* c = text; *c; c++) {
+        int glyph = glyphIndex(*c);
+        if (glyph != 0) {
+            float u0 = static_cast<float>(glyph * CELL_WIDTH) / ATLAS_WIDTH;
+            float u1 = static_cast<float>(glyph * CELL_WIDTH + 5) / ATLAS_WIDTH;
+            float v1 = 7.0f / ATLAS_HEIGHT;
+            addQuad(x, y, 5 * TEXT_SCALE, 7 * TEXT_SCALE, u0, 0.0f, u1, v1, color);
+        }
+        x += CELL_WIDTH * TEXT_SCALE;
+    }
+}
+
+void Hud::draw(const HudStats& stats) {
+    if (!visible || atlas == nullptr) return;
+    MYGAME_PROFILE_ZONE("Draw HUD");
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    //Percentiles over the history, at most 120 values so a copy and nth_element is enough
+    sorted.assign(frameTimes, frameTimes + frameCount);
+    double total = 0.0;
+    for (double time : sorted) total += time;
+    double p50 = 0.0;
+    double p99 = 0.0;
+    if (!sorted.empty()) {
+        size_t middle = sorted.size() / 2;
+        size_t high = (sorted.size() * 99) / 100;
+        std::nth_element(sorted.begin(), sorted.begin() + middle, sorted.end());
+        p50 = sorted[middle];
+        std::nth_element(sorted.begin(), sorted.begin() + high, sorted.end());
+        p99 = sorted[high];
+    }
+    double fps = total > 0.0 ? frameCount / total : 0.0;
+
+    vertices.clear();
+    indices.clear();
+
+    const int lines = 6;
+    float panelHeight = lines * LINE_HEIGHT + GRAPH_HEIGHT + 12.0f;
+    addSolid(PANEL_X, PANEL_Y, PANEL_WIDTH, panelHeight, PANEL_COLOR);
+
+    char line[48];
+    float x = PANEL_X + 6.0f;
+    float y = PANEL_Y + 6.0f;
+    std::snprintf(line, sizeof(line), "FPS %.1f", fps);
+    addText(x, y, line, TEXT_COLOR);
+    y += LINE_HEIGHT;
+    std::snprintf(line, sizeof(line), "P50 %.2f P99 %.2f MS", p50 * 1000.0, p99 * 1000.0);
+    addText(x, y, line, TEXT_COLOR);
+    y += LINE_HEIGHT;
+    std::snprintf(line, sizeof(line), "TICKS %llu", static_cast<unsigned long long>(stats.ticks));
+    addText(x, y, line, TEXT_COLOR);
+    y += LINE_HEIGHT;
+    std::snprintf(line, sizeof(line), "CARS %zu", stats.cars);
+    addText(x, y, line, TEXT_COLOR);
+    y += LINE_HEIGHT;
+    std::snprintf(line, sizeof(line), "DRAW CALLS %d", stats.renderCommands);
+    addText(x, y, line, TEXT_COLOR);
+    y += LINE_HEIGHT;
+    std::snprintf(line, sizeof(line), "HUD %.3f MS", drawSeconds * 1000.0);
+    addText(x, y, line, TEXT_COLOR);
+    y += LINE_HEIGHT;
+
+    //Frame time graph, oldest frame on the left, with a line at 60 FPS
+    float barWidth = (PANEL_WIDTH - 12.0f) / HISTORY;
+    float graphBottom = y + GRAPH_HEIGHT;
+    for (size_t i = 0; i < frameCount; i++) {
+        size_t frame = (nextFrame + HISTORY - frameCount + i) % HISTORY;
+        double time = frameTimes[frame];
+        float height = static_cast<float>(std::min(time / GRAPH_RANGE, 1.0) * GRAPH_HEIGHT);
+        SDL_Color color = time <= 1.0 / 59.0 ? FAST_COLOR : (time <= GRAPH_RANGE ? SLOW_COLOR : MISSED_COLOR);
+        addSolid(x + i * barWidth, graphBottom - height, barWidth, height, color);
+    }
+    float target = static_cast<float>((1.0 / 60.0) / GRAPH_RANGE * GRAPH_HEIGHT);
+    addSolid(x, graphBottom - target, PANEL_WIDTH - 12.0f, 1.0f, TARGET_COLOR);
+
+    SDL_RenderGeometry(renderer, atlas, vertices.data(), static_cast<int>(vertices.size()),
+                       indices.data(), static_cast<int>(indices.size()));
+
+    drawSeconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
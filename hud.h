@@ -0,0 +1,59 @@
+#ifndef MYGAME_HUD_H
+#define MYGAME_HUD_H
+
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+//Numbers shown by the HUD besides the frame times
+struct HudStats {
+    uint64_t ticks = 0;
+    size_t cars = 0;
+    //Render calls issued for the frame, the HUD's own call included
+    int renderCommands = 0;
+};
+
+//Performance overlay: FPS, p50 and p99 frame time, a frame time graph and the HudStats.
+//Text and graph are quads on one small font atlas, so the whole overlay is a single
+//SDL_RenderGeometry call. The vertex buffers are reused between frames.
+class Hud {
+
+private:
+    static constexpr size_t HISTORY = 120;
+
+    SDL_Renderer* renderer;
+    SDL_Texture* atlas = nullptr;
+    bool visible = false;
+    double frameTimes[HISTORY] = {};
+    size_t frameCount = 0;
+    size_t nextFrame = 0;
+    //Time the last draw() took, shown so the overlay's own cost stays visible
+    double drawSeconds = 0.0;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+    std::vector<double> sorted;
+
+    void addQuad(float x, float y, float w, float h, float u0, float v0, float u1, float v1, SDL_Color color);
+    void addSolid(float x, float y, float w, float h, SDL_Color color);
+    void addText(float x, float y, const char* text, SDL_Color color);
+
+public:
+
+    explicit Hud(SDL_Renderer* renderer);
+    ~Hud();
+
+    Hud(const Hud&) = delete;
+    Hud& operator=(const Hud&) = delete;
+
+    void toggle() { visible = !visible; }
+    bool isVisible() const { return visible; }
+
+    //Adds one frame to the history, call every frame even while hidden
+    void recordFrame(double seconds);
+
+    void draw(const HudStats& stats);
+};
+
+#endif //MYGAME_HUD_H
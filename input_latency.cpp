@@ -0,0 +1,74 @@
+#include "input_latency.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+
+
+void LatencyHistogram::record(double seconds) {
+    size_t bucket = std::min(static_cast<size_t>(seconds * 1000.0), LATENCY_BUCKETS);
+    buckets[bucket]++;
+    count++;
+    sum += seconds;
+    max = std::max(max, seconds);
+}
+
+double LatencyHistogram::percentile(double fraction) const {
+    if (count == 0) return 0.0;
+    uint64_t wanted = static_cast<uint64_t>(fraction * (count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += buckets[bucket];
+        if (seen >= wanted) return (bucket + 1) / 1000.0;
+    }
+    return max;
+}
+
+void LatencyHistogram::print(std::ostream& out, const char* name, bool bars) const {
+    out << name << ": " << count << " samples, mean " << mean() * 1000.0 << " ms, p50 "
+        << percentile(0.5) * 1000.0 << " ms, p99 " << percentile(0.99) * 1000.0 << " ms, max "
+        << max * 1000.0 << " ms" << std::endl;
+    if (!bars || count == 0) return;
+
+    uint64_t highest = *std::max_element(buckets, buckets + LATENCY_BUCKETS + 1);
+    for (size_t bucket = 0; bucket <= LATENCY_BUCKETS; bucket++) {
+        if (buckets[bucket] == 0) continue;
+        size_t width = static_cast<size_t>((buckets[bucket] * 40 + highest - 1) / highest);
+        out << "  " << std::setw(3) << bucket << (bucket < LATENCY_BUCKETS ? "   ms " : "+  ms ")
+            << std::string(width, '#') << " " << buckets[bucket] << std::endl;
+    }
+}
+
+
+Uint64 InputLatencyTracker::eventTime(Uint32 timestamp) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint32 age = SDL_GetTicks() - timestamp;
+    Uint64 ageTicks = static_cast<Uint64>(age) * SDL_GetPerformanceFrequency() / 1000;
+    return ageTicks < now ? now - ageTicks : now;
+}
+
+void InputLatencyTracker::inputSent(Uint64 eventTime) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    //The sequence matches the simulation thread's count of applied inputs once this one is applied
+    sent++;
+    if (eventTime == 0) return;
+    pending.push_back({ sent, eventTime, now });
+    toQueue.record(seconds(eventTime, now));
+}
+
+void InputLatencyTracker::framePresented(uint64_t inputsApplied, Uint64 presentStart, Uint64 presentEnd) {
+    presents.record(seconds(presentStart, presentEnd));
+    while (!pending.empty() && pending.front().sequence <= inputsApplied) {
+        const PendingInput& input = pending.front();
+        toScreen.record(seconds(input.sentTime, presentEnd));
+        toPhoton.record(seconds(input.eventTime, presentEnd));
+        pending.pop_front();
+    }
+}
+
+void InputLatencyTracker::print(std::ostream& out) const {
+    toQueue.print(out, "Input event to simulation queue", false);
+    toScreen.print(out, "Simulation queue to present", false);
+    presents.print(out, "Present call", false);
+    toPhoton.print(out, "Input to photon", true);
+}
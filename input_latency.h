@@ -0,0 +1,80 @@
+#ifndef MYGAME_INPUT_LATENCY_H
+#define MYGAME_INPUT_LATENCY_H
+
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+
+
+//Counts of latencies in 1 ms buckets up to LATENCY_BUCKETS ms, longer ones share the last bucket
+class LatencyHistogram {
+
+public:
+    static constexpr size_t LATENCY_BUCKETS = 100;
+
+private:
+    uint64_t buckets[LATENCY_BUCKETS + 1] = {};
+    uint64_t count = 0;
+    double sum = 0.0;
+    double max = 0.0;
+
+public:
+
+    void record(double seconds);
+
+    uint64_t getCount() const { return count; }
+    double mean() const { return count > 0 ? sum / count : 0.0; }
+    double getMax() const { return max; }
+
+    //Upper edge of the bucket holding the given fraction of samples, in seconds
+    double percentile(double fraction) const;
+
+    //One line with the percentiles, then a bar per non-empty bucket when bars is set
+    void print(std::ostream& out, const char* name, bool bars) const;
+};
+
+//Follows player inputs from the SDL event to the first present that shows their effect.
+//Inputs are numbered in the order they enter the simulation thread's queue, and each
+//published tick carries how many of them it has applied, so a frame knows which inputs
+//it is the first to draw. Times are SDL_GetPerformanceCounter ticks.
+class InputLatencyTracker {
+
+private:
+    struct PendingInput {
+        uint64_t sequence;
+        Uint64 eventTime;
+        Uint64 sentTime;
+    };
+
+    Uint64 frequency;
+    uint64_t sent = 0;
+    std::deque<PendingInput> pending;
+    LatencyHistogram toQueue;
+    LatencyHistogram toScreen;
+    LatencyHistogram toPhoton;
+    LatencyHistogram presents;
+
+    double seconds(Uint64 from, Uint64 to) const {
+        return to > from ? static_cast<double>(to - from) / frequency : 0.0;
+    }
+
+public:
+
+    InputLatencyTracker() : frequency(SDL_GetPerformanceFrequency()) {}
+
+    //Counter time of an SDL event. Event timestamps only have millisecond resolution.
+    static Uint64 eventTime(Uint32 timestamp);
+
+    //An input caused by the event at eventTime was queued for the simulation thread. Inputs
+    //no event caused (eventTime 0) keep the numbering in step but are not measured.
+    void inputSent(Uint64 eventTime);
+
+    //A frame drawing a tick that had applied inputsApplied inputs was presented
+    void framePresented(uint64_t inputsApplied, Uint64 presentStart, Uint64 presentEnd);
+
+    void print(std::ostream& out) const;
+};
+
+#endif //MYGAME_INPUT_LATENCY_H
@@ -0,0 +1,114 @@
+#include "job_system.h"
+
+#include <algorithm>
+
+
+namespace {
+
+//Queue of the worker running on this thread, SIZE_MAX elsewhere
+thread_local size_t workerIndex = SIZE_MAX;
+thread_local const void* workerOwner = nullptr;
+
+}
+
+
+JobSystem::JobSystem(size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    //The thread calling wait() gets a queue too, it is the last one
+    for (size_t i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i + 1 < threads; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void JobSystem::submit(std::function<void()> job) {
+    size_t index = workerOwner == this ? workerIndex
+                                       : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->jobs.push_back(std::move(job));
+    }
+    //Taking the lock orders the push before a sleeping worker's check of its wait condition
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wake.notify_one();
+}
+
+bool JobSystem::takeJob(size_t index, std::function<void()>& job) {
+    {
+        Queue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue& victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::runJob(std::function<void()>& job) {
+    job();
+    job = nullptr;
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        finished.notify_all();
+    }
+}
+
+void JobSystem::workerLoop(size_t index) {
+    workerIndex = index;
+    workerOwner = this;
+    std::function<void()> job;
+    while (true) {
+        if (takeJob(index, job)) {
+            runJob(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        //Jobs queued and not yet taken, checked again under the lock so a submit is not missed
+        wake.wait(lock, [this, index] {
+            if (stopping) return true;
+            for (const auto& queue : queues) {
+                std::lock_guard<std::mutex> queueLock(queue->mutex);
+                if (!queue->jobs.empty()) return true;
+            }
+            return false;
+        });
+        if (stopping) return;
+    }
+}
+
+void JobSystem::wait() {
+    size_t index = queues.size() - 1;
+    std::function<void()> job;
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (takeJob(index, job)) {
+            runJob(job);
+            continue;
+        }
+        //Everything left is running on the workers
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        finished.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef MYGAME_JOB_SYSTEM_H
+#define MYGAME_JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//Work stealing pool for many independent jobs of uneven length, such as whole races.
+//Every worker has its own deque: it takes its newest job from the back while idle
+//workers steal the oldest ones from the front, so a worker stuck on a long job does
+//not hold up the ones queued behind it. Unlike WorkerPool jobs may submit more jobs.
+class JobSystem {
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    //Submitted jobs that have not finished yet
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> nextQueue{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    bool stopping = false;
+
+    void workerLoop(size_t index);
+    //Pops from the back of the own queue, then steals from the front of the others
+    bool takeJob(size_t index, std::function<void()>& job);
+    void runJob(std::function<void()>& job);
+
+public:
+
+    //threads = 0 uses one thread per core, the caller of wait() helps as well
+    explicit JobSystem(size_t threads = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    //Queues a job, from a worker it goes to that worker's own deque
+    void submit(std::function<void()> job);
+
+    //Runs queued jobs on the calling thread until every submitted job has finished.
+    //Not for use inside a job, that job would be waiting on itself.
+    void wait();
+
+    size_t getThreadCount() const { return workers.size() + 1; }
+};
+
+#endif //MYGAME_JOB_SYSTEM_H
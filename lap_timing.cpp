@@ -0,0 +1,71 @@
+#include "lap_timing.h"
+
+#include <algorithm>
+
+
+//Drawn across the road from grass to grass, see resources/track_mask.bmp
+const std::vector<TimingLine> TRACK_TIMING_LINES = {
+        //Finish line on the top straight, crossed to the right
+        {475, 48, 475, 160},
+        //Right hand straight, crossed downwards
+        {790, 330, 630, 330},
+        //Inner straight, crossed upwards
+        {376, 300, 536, 300},
+        //Left hand straight, crossed upwards
+        {10, 330, 170, 330}
+};
+
+
+bool isAhead(const CarTiming& a, const CarTiming& b, size_t lineCount) {
+    int aProgress = a.progress(lineCount);
+    int bProgress = b.progress(lineCount);
+    if (aProgress != bProgress) return aProgress > bProgress;
+    return aProgress > 0 && a.lastCrossing < b.lastCrossing;
+}
+
+
+LapTimer::LapTimer(std::vector<TimingLine> timingLines) : lines(std::move(timingLines)) {
+    if (lines.size() > MAX_TIMING_LINES) lines.resize(MAX_TIMING_LINES);
+}
+
+bool LapTimer::update(CarTiming& timing, double x0, double y0, double x1, double y1, double start, double dt) const {
+    if (lines.empty()) return false;
+    const TimingLine& line = lines[timing.nextLine];
+
+    //Signed distances of both ends of the path along the line's normal, scaled by its length
+    double ex = line.x1 - line.x0;
+    double ey = line.y1 - line.y0;
+    double before = (x0 - line.x0) * ey - (y0 - line.y0) * ex;
+    double after = (x1 - line.x0) * ey - (y1 - line.y0) * ex;
+    if (!(before < 0.0 && after >= 0.0)) return false;
+
+    //Where the path meets the line, it has to be within the segment
+    double fraction = before / (before - after);
+    double x = x0 + (x1 - x0) * fraction;
+    double y = y0 + (y1 - y0) * fraction;
+    double along = (x - line.x0) * ex + (y - line.y0) * ey;
+    if (along < 0.0 || along > ex * ex + ey * ey) return false;
+
+    double time = start + dt * fraction;
+    if (!timing.started) {
+        timing.started = true;
+        timing.lapStart = time;
+        timing.lastCrossing = time;
+        timing.nextLine = lines.size() > 1 ? 1 : 0;
+        return false;
+    }
+
+    //The sector that ends at this line
+    size_t sector = (timing.nextLine + lines.size() - 1) % lines.size();
+    timing.sectors[sector] = time - timing.lastCrossing;
+    timing.lastCrossing = time;
+    timing.nextLine = (timing.nextLine + 1) % lines.size();
+    if (sector + 1 != lines.size()) return false;
+
+    timing.lapsCompleted++;
+    timing.lastLap = time - timing.lapStart;
+    if (timing.bestLap == 0.0 || timing.lastLap < timing.bestLap) timing.bestLap = timing.lastLap;
+    std::copy(timing.sectors, timing.sectors + MAX_TIMING_LINES, timing.lastLapSectors);
+    timing.lapStart = time;
+    return true;
+}
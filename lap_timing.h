@@ -0,0 +1,70 @@
+#ifndef MYGAME_LAP_TIMING_H
+#define MYGAME_LAP_TIMING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+//Line across the track that cars cross in the direction (y1 - y0, x0 - x1), the
+//segment's normal. Crossing it the other way does not count.
+struct TimingLine {
+    double x0;
+    double y0;
+    double x1;
+    double y1;
+};
+
+constexpr size_t MAX_TIMING_LINES = 8;
+constexpr int RACE_LAPS = 2;
+
+//The finish line first, then the sector checkpoints in driving order
+extern const std::vector<TimingLine> TRACK_TIMING_LINES;
+
+//Lap and sector times of one car in seconds of race time. Plain data so it can be
+//part of a rollback snapshot.
+struct CarTiming {
+    int lapsCompleted = 0;
+    //Line the car has to cross next, the first crossing of the finish line starts lap one
+    uint32_t nextLine = 0;
+    bool started = false;
+    double lapStart = 0.0;
+    double lastCrossing = 0.0;
+    //Sector i ends at line i + 1, the last sector ends at the finish line
+    double sectors[MAX_TIMING_LINES] = {};
+    double lastLapSectors[MAX_TIMING_LINES] = {};
+    double lastLap = 0.0;
+    //0 until a lap has been completed
+    double bestLap = 0.0;
+
+    //How far round the race the car is, in lines crossed. On the last sector nextLine has
+    //already wrapped to the finish line while the lap is not complete yet.
+    int progress(size_t lineCount) const {
+        int lines = static_cast<int>(lineCount);
+        return started ? lapsCompleted * lines + (nextLine == 0 ? lines : static_cast<int>(nextLine)) : 0;
+    }
+};
+
+//True when a is further round the race than b, or equally far and got there first
+bool isAhead(const CarTiming& a, const CarTiming& b, size_t lineCount);
+
+//Times crossings of the timing lines from the path each car's centre swept during a
+//tick. Only the line a car has to cross next is tested, so a tick costs one segment
+//test per car, and the crossing is interpolated along the path to a time within the tick.
+class LapTimer {
+
+private:
+    std::vector<TimingLine> lines;
+
+public:
+
+    explicit LapTimer(std::vector<TimingLine> timingLines);
+
+    //The car's centre moved from (x0, y0) to (x1, y1) during the tick from start to
+    //start + dt. True when that completed a lap.
+    bool update(CarTiming& timing, double x0, double y0, double x1, double y1, double start, double dt) const;
+
+    size_t getLineCount() const { return lines.size(); }
+};
+
+#endif //MYGAME_LAP_TIMING_H
@@ -1,13 +1,27 @@
-#include <chrono>
 #include <SDL2/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <vector>
-#include <cmath>
-
-
-constexpr int WINDOW_WIDTH = 800;
-constexpr int WINDOW_HEIGHT = 600;
 
+#include "asset_manager.h"
+#include "background_layer.h"
+#include "car_pool.h"
+#include "frame_scheduler.h"
+#include "hud.h"
+#include "input_latency.h"
+#include "netcode.h"
+#include "profiler.h"
+#include "replay.h"
+#include "simulation.h"
+#include "simulation_thread.h"
+#include "state_replay.h"
+#include "sprite_batch.h"
+#include "sweep.h"
+#include "track_layout.h"
+#include "track_streamer.h"
 
 
 bool init(SDL_Window*& window, SDL_Renderer*& renderer) {
@@ -32,359 +46,612 @@ bool init(SDL_Window*& window, SDL_Renderer*& renderer) {
     return true;
 }
 
-SDL_Texture* loadTexture(const std::string& path, SDL_Renderer* renderer) {
-    SDL_Texture* newTexture = nullptr;
-    SDL_Surface* loadedSurface = SDL_LoadBMP(path.c_str());
-    if (loadedSurface == nullptr) {
-        std::cerr << "Unable to load image " << path << "! SDL Error: " << SDL_GetError() << std::endl;
-    } else {
-        SDL_SetColorKey(loadedSurface, SDL_TRUE, SDL_MapRGB(loadedSurface->format,127, 127, 127));
-        newTexture = SDL_CreateTextureFromSurface(renderer, loadedSurface);
-        if (newTexture == nullptr) {
-            std::cerr << "Unable to create texture from " << path << "! SDL Error: " << SDL_GetError() << std::endl;
-        }
-        SDL_FreeSurface(loadedSurface);
-    }
-    return newTexture;
-}
-
-void cleanup(SDL_Window* window, SDL_Renderer* renderer, std::vector<SDL_Texture*>& textures) {
-    for (SDL_Texture* texture : textures) {
-        SDL_DestroyTexture(texture);
-    }
+void cleanup(SDL_Window* window, SDL_Renderer* renderer) {
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
 
-union vect_t {
-    struct { double x; double y;} v;
+//Built from TEXTURE_MANIFEST by the mygame_pack target
+const char* ASSET_PACK_PATH = "resources/assets.pack";
+
+//Every image the game draws, loaded before the first frame
+const std::vector<std::string> TEXTURE_MANIFEST = {
+        "resources/track.bmp",
+        "resources/car1.bmp",
+        "resources/car2.bmp",
+        "resources/winner1.bmp",
+        "resources/winner2.bmp"
 };
 
-vect_t operator+(const vect_t a, const vect_t b) {
-    vect_t ret = a;
-    ret.v.x += b.v.x;
-    ret.v.y += b.v.y;
-    return ret;
-}
-vect_t operator*(const vect_t a, const double b) {
-    vect_t ret = a;
-    ret.v.x *= b;
-    ret.v.y *= b;
-    return ret;
-}
 
-vect_t operator-(const vect_t a, const vect_t b) {
-    vect_t ret = a;
-    ret.v.x -= b.v.x;
-    ret.v.y -= b.v.y;
-    return ret;
+//Print winner message for players
+void printWinner(SDL_Renderer* renderer, SDL_Texture* winnerTexture) {
+    SDL_Rect dstRect = { 0 , 0, WINDOW_WIDTH, WINDOW_HEIGHT };
+    SDL_RenderCopy(renderer, winnerTexture, nullptr, &dstRect);
 }
 
-class Car {
-
-private:
-    SDL_Rect carRect;
-    SDL_Rect finishLine = {470,100,10,50};
-    vect_t position = { 0, 0 };
-    vect_t velocity = { 0, 0 };
-    vect_t acceleration = { 0, 0 };
-    double angle = 90.;
-    double accelerationValue = 0.0;
-    std::vector<SDL_Rect> trackBounds = {
-        {170, 160, 385, 5},
-        {170, 160, 5, 314},
-        {557, 160, 5, 314},
-        {355, 298, 5, 302}
-    };
-    int timesPassedFinishLine = 0;
-
-    SDL_Texture* texture;
 
-public:
+struct GameOptions {
+    bool headless = false;
+    double physicsRate = 120.;
+    size_t stressCars = 0;
+    //AI cars added behind the two players in the window
+    size_t opponents = 0;
+    std::string recordPath;
+    std::string replayPath;
+    //Full state of every tick, for reviewing a race or racing it as a ghost
+    std::string recordStatePath;
+    std::string ghostPath;
+    //Headless: times seeking through a state replay
+    std::string stateReplayPath;
+    //Chrome trace written on exit and when F12 is pressed, needs MYGAME_PROFILE
+    std::string tracePath = "trace.json";
+    //Headless parameter sweep written as CSV, one race per row
+    std::string sweepPath;
+    //Headless two player race through rollback sessions over a loopback network
+    bool netplay = false;
+    double latency = 0.05;
+    double lossRate = 0.0;
+    //Render loop pacing, the rate defaults to the display's refresh rate
+    PacingMode pacing = PacingMode::TargetRate;
+    double frameRate = 0.0;
+    HeadlessOptions headlessOptions;
+    SweepOptions sweepOptions;
+};
 
-    Car(int x, int y, SDL_Texture* tex) : texture(tex) {
-        position.v.x = x;
-        position.v.y = y;
-        carRect = { x, y, 20, 40 };
+//Parses --physics-hz N, --record FILE, --replay FILE, --record-state FILE, --ghost FILE,
+//--trace FILE, --opponents N, --threads N, --track-scale N, --pacing target|low-latency|power-save,
+//--fps N and
+//--headless [--races N] [--cars N] [--ticks N] [--seed N] [--stress-cars N] [--ai]
+//[--sweep FILE [--sweep-races N]] [--netplay [--latency MS] [--loss P]] [--state-replay FILE]
+GameOptions parseOptions(int argc, char* argv[]) {
+    GameOptions gameOptions;
+    HeadlessOptions& options = gameOptions.headlessOptions;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            gameOptions.headless = true;
+        } else if (std::strcmp(argv[i], "--physics-hz") == 0 && i + 1 < argc) {
+            double rate = std::atof(argv[++i]);
+            if (rate > 0.0) gameOptions.physicsRate = rate;
+        } else if (std::strcmp(argv[i], "--races") == 0 && i + 1 < argc) {
+            options.races = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--cars") == 0 && i + 1 < argc) {
+            options.cars = std::max<size_t>(2, std::strtoull(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            options.maxTicks = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--stress-cars") == 0 && i + 1 < argc) {
+            gameOptions.stressCars = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            gameOptions.recordPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            gameOptions.replayPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--record-state") == 0 && i + 1 < argc) {
+            gameOptions.recordStatePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--ghost") == 0 && i + 1 < argc) {
+            gameOptions.ghostPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--state-replay") == 0 && i + 1 < argc) {
+            gameOptions.stateReplayPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--ai") == 0) {
+            options.aiDrivers = true;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--opponents") == 0 && i + 1 < argc) {
+            gameOptions.opponents = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            gameOptions.tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--sweep") == 0 && i + 1 < argc) {
+            gameOptions.sweepPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--sweep-races") == 0 && i + 1 < argc) {
+            gameOptions.sweepOptions.races = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--track-scale") == 0 && i + 1 < argc) {
+            options.trackScale = std::min(std::max(std::atoi(argv[++i]), 1), MAX_TRACK_SCALE);
+        } else if (std::strcmp(argv[i], "--pacing") == 0 && i + 1 < argc) {
+            i++;
+            if (std::strcmp(argv[i], "low-latency") == 0) gameOptions.pacing = PacingMode::LowLatency;
+            else if (std::strcmp(argv[i], "power-save") == 0) gameOptions.pacing = PacingMode::PowerSave;
+            else gameOptions.pacing = PacingMode::TargetRate;
+        } else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            gameOptions.frameRate = std::max(0.0, std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--netplay") == 0) {
+            gameOptions.netplay = true;
+        } else if (std::strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            gameOptions.latency = std::max(0.0, std::atof(argv[++i]) / 1000.0);
+        } else if (std::strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+            gameOptions.lossRate = std::clamp(std::atof(argv[++i]), 0.0, 0.95);
+        }
     }
+    options.dt = 1. / gameOptions.physicsRate;
+    gameOptions.sweepOptions.threads = options.threads;
+    return gameOptions;
+}
 
+void printHeadlessResult(const HeadlessResult& result) {
+    std::cout << "Races: " << result.racesRun << " (" << result.racesFinished << " finished)" << std::endl;
+    std::cout << "Ticks: " << result.ticks << " in " << result.seconds << " s" << std::endl;
+    std::cout << "Car collisions: " << result.collisions << std::endl;
+    if (result.bestLap > 0.0) std::cout << "Best lap: " << result.bestLap << " s" << std::endl;
+    std::cout << "Ticks per second: " << static_cast<uint64_t>(result.ticksPerSecond()) << std::endl;
+    std::cout << "Checksum: " << std::hex << result.checksum << std::dec << std::endl;
+}
 
-    void accelerate(double value) {
-        accelerationValue = value;
-    }
+//Scripted races, the first one is recorded when a record path is given
+int runHeadlessMode(const GameOptions& gameOptions) {
+    const HeadlessOptions& options = gameOptions.headlessOptions;
+    std::shared_ptr<const TrackMap> track = loadTrackMap(createTrackLayout(options.trackScale));
+    if (!track) return 1;
 
-    void decelerate(double value) {
-        accelerationValue = -value*0.8;
+    InputRecorder recorder(options.cars, options.dt, options.trackScale);
+    StateReplayWriter stateWriter;
+    if (!gameOptions.recordStatePath.empty() && !stateWriter.open(gameOptions.recordStatePath, options.cars, options.dt)) {
+        return 1;
     }
+    printHeadlessResult(runHeadless(options, track, gameOptions.recordPath.empty() ? nullptr : &recorder,
+                                    stateWriter.isOpen() ? &stateWriter : nullptr));
+    if (!gameOptions.recordPath.empty() && !recorder.save(gameOptions.recordPath)) return 1;
+    if (!stateWriter.close()) return 1;
+    if (PROFILER_ENABLED) writeChromeTrace(gameOptions.tracePath);
+    return 0;
+}
 
-    //Turning the vehicle
-    void turnLeft(double value) { angle -= value; }
-    void turnRight(double value) { angle += value; }
+int runReplayMode(const GameOptions& gameOptions) {
+    InputReplay replay;
+    if (!replay.load(gameOptions.replayPath)) return 1;
+    std::shared_ptr<const TrackMap> track = loadTrackMap(createTrackLayout(replay.getTrackScale()));
+    if (!track) return 1;
+    printHeadlessResult(runReplay(replay, track));
+    if (PROFILER_ENABLED) writeChromeTrace(gameOptions.tracePath);
+    return 0;
+}
 
-    void draw(SDL_Renderer* renderer) const {
-        SDL_RenderCopyEx(renderer, texture, nullptr, &carRect, angle, nullptr, SDL_FLIP_NONE);
+//Decodes a state replay front to back, then seeks to random ticks
+int runStateReplayMode(const GameOptions& gameOptions) {
+    StateReplayReader reader;
+    if (!reader.open(gameOptions.stateReplayPath)) return 1;
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t frames = 1;
+    while (reader.next()) frames++;
+    double playSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int winner = reader.frame().winner;
+
+    const int seeks = 10000;
+    uint32_t random = gameOptions.headlessOptions.seed;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < seeks; i++) {
+        random = random * 1664525u + 1013904223u;
+        if (!reader.seek(random % reader.getTickCount())) return 1;
     }
+    double seekSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Ticks: " << reader.getTickCount() << " (" << reader.getTickCount() * reader.getStep() << " s), "
+              << reader.getCarCount() << " cars, winner " << winner << std::endl;
+    std::cout << "File: " << reader.getFileSize() << " bytes, "
+              << static_cast<double>(reader.getFileSize()) / reader.getTickCount() << " per tick" << std::endl;
+    std::cout << "Playback: " << frames << " ticks in " << playSeconds * 1000.0 << " ms" << std::endl;
+    std::cout << "Seek: " << seekSeconds / seeks * 1e6 << " us on average" << std::endl;
+    return frames == reader.getTickCount() ? 0 : 1;
+}
 
-    void update(double dt) {
-        acceleration.v.y = -accelerationValue * std::cos(angle * M_PI / 180.0);
-        acceleration.v.x = accelerationValue * std::sin(angle * M_PI / 180.0);
-
-
-        //Physics using acceleration and velocity to determin position
-        this->position = this->position + (this->velocity * dt) + (this->acceleration * dt * dt * 0.5);
-        this->velocity = this->velocity + (this->acceleration * dt);
-        this->velocity = this->velocity * 0.99;
-
-        //Collision with map trackBound so player can't go out of trackBounds
-        if (position.v.x < 0) {
-            position.v.x = 0;
-            velocity.v.x = -velocity.v.x;
-        }
-        if (position.v.x + carRect.w > WINDOW_WIDTH) {
-            position.v.x = WINDOW_WIDTH - carRect.w;
-            velocity.v.x = -velocity.v.x;
-        }
-        if (position.v.y < 0) {
-            position.v.y = 0;
-            velocity.v.y = -velocity.v.y;
-        }
-        if (position.v.y + carRect.h > WINDOW_HEIGHT) {
-            position.v.y = WINDOW_HEIGHT - carRect.h;
-            velocity.v.y = -velocity.v.y;
-        }
-
-
-        //Handle collision with track bounds
-        for (const auto& trackBound : trackBounds) {
-            if (SDL_HasIntersection(&carRect, &trackBound)) {
-                //Determine the side of the collision
-
-                //From the left
-                if (position.v.x + carRect.w > trackBound.x && position.v.x < trackBound.x) {
-                    position.v.x = trackBound.x - carRect.w;
-                    velocity.v.x = -velocity.v.x * 0.5; 
-                }
-
-                //From the right
-                if (position.v.x < trackBound.x + trackBound.w && position.v.x + carRect.w > trackBound.x + trackBound.w) {
-                    position.v.x = trackBound.x + trackBound.w;
-                    velocity.v.x = -velocity.v.x * 0.5; 
-                }
-
-                //From above
-                if (position.v.y + carRect.h > trackBound.y && position.v.y < trackBound.y) {
-                    position.v.y = trackBound.y - carRect.h;
-                    velocity.v.y = -velocity.v.y * 0.5; 
-                }
-
-                //From below
-                if (position.v.y < trackBound.y + trackBound.h && position.v.y + carRect.h > trackBound.y + trackBound.h) {
-                    position.v.y = trackBound.y + trackBound.h;
-                    velocity.v.y = -velocity.v.y * 0.5; 
-                }
-            }
-        }
-
-        //Update player rect based on the calculated position
-        this->carRect.x = static_cast<int>(this->position.v.x);
-        this->carRect.y = static_cast<int>(this->position.v.y);
+//Races with sampled physics parameters spread over every core
+int runSweepMode(const GameOptions& gameOptions) {
+    std::shared_ptr<const TrackMap> track = loadTrackMap(createTrackLayout(gameOptions.headlessOptions.trackScale));
+    if (!track) return 1;
+
+    const HeadlessOptions& options = gameOptions.headlessOptions;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SweepRace> races = runSweep(gameOptions.sweepOptions, options, track);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t ticks = 0;
+    int finished = 0;
+    for (const SweepRace& race : races) {
+        ticks += race.result.ticks;
+        if (race.result.finished) finished++;
     }
+    std::cout << "Races: " << races.size() << " (" << finished << " finished)" << std::endl;
+    std::cout << "Ticks: " << ticks << " in " << seconds << " s" << std::endl;
+    std::cout << "Races per second: " << (seconds > 0.0 ? races.size() / seconds : 0.0) << std::endl;
 
+    if (PROFILER_ENABLED) writeChromeTrace(gameOptions.tracePath);
+    return writeSweepCsv(gameOptions.sweepPath, races) ? 0 : 1;
+}
 
-    //Handling car collision with each other
-    bool checkCollision(const Car& other) const {
-        return SDL_HasIntersection(&this->carRect, &other.carRect);
+//Both players of a rollback race in one process, checked against the race without a network
+int runNetplayMode(const GameOptions& gameOptions) {
+    std::shared_ptr<const TrackMap> track = loadTrackMap(createTrackLayout(gameOptions.headlessOptions.trackScale));
+    if (!track) return 1;
+
+    NetplayResult result = runLoopbackRace(gameOptions.headlessOptions, track, gameOptions.latency,
+                                           gameOptions.lossRate);
+    std::cout << "Ticks: " << result.ticks << " in " << result.seconds << " s" << std::endl;
+    std::cout << "Packets: " << result.packetsSent << " sent, " << result.packetsLost << " lost" << std::endl;
+    for (int player = 0; player < 2; player++) {
+        const RollbackStats& stats = result.stats[player];
+        std::cout << "Player " << player + 1 << ": " << stats.rollbacks << " rollbacks, "
+                  << stats.resimulatedTicks << " ticks re-simulated (at most " << stats.maxResimulatedTicks
+                  << ", " << stats.maxRollbackSeconds * 1000.0 << " ms), " << stats.stalls << " stalls" << std::endl;
     }
+    std::cout << "Checksum: " << std::hex << result.checksums[0] << " " << result.checksums[1]
+              << " reference " << result.referenceChecksum << std::dec << std::endl;
+    std::cout << (result.inSync() ? "In sync" : "Desync") << std::endl;
 
-    void handleCollision(Car& other) {
-
-        vect_t temp = this->velocity;
-        this->velocity = other.velocity;
-        other.velocity = temp;
-
-        vect_t displacement = this->position - other.position;
-        double distance = std::sqrt(displacement.v.x * displacement.v.x + displacement.v.y * displacement.v.y);
-        double overlap = 0.5 * (distance - (this->carRect.w + other.carRect.w) / 2);
-
-        this->position.v.x -= overlap * (this->position.v.x - other.position.v.x) / distance;
-        this->position.v.y -= overlap * (this->position.v.y - other.position.v.y) / distance;
+    if (PROFILER_ENABLED) writeChromeTrace(gameOptions.tracePath);
+    return result.inSync() ? 0 : 1;
+}
 
-        other.position.v.x += overlap * (this->position.v.x - other.position.v.x) / distance;
-        other.position.v.y += overlap * (this->position.v.y - other.position.v.y) / distance;
+//Times the integration pass races run through the car pool, for every instruction set this
+//machine supports. Walls and collisions are left out, see --headless for whole races.
+int runStressMode(size_t cars, const HeadlessOptions& options) {
+    uint64_t ticks = options.maxTicks < 1000 ? options.maxTicks : 1000;
+    std::vector<SimdLevel> levels = { SimdLevel::Scalar };
+    if (detectSimdLevel() >= SimdLevel::SSE2) levels.push_back(SimdLevel::SSE2);
+    if (detectSimdLevel() >= SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+
+    std::cout << "Races run on " << (RACE_FIXED_POINT ? "fixed point" : "double") << " (MYGAME_FIXED_POINT "
+              << (RACE_FIXED_POINT ? "ON" : "OFF") << ")" << std::endl;
+    //Both pool scalars, the fixed point checksums must match across levels and builds
+    for (SimdLevel level : levels) {
+        StressResult result = runCarPoolStress<double>(cars, ticks, options.dt, level);
+        StressResult fixed = runCarPoolStress<Fixed>(cars, ticks, options.dt, level);
+        std::cout << simdLevelName(level) << ": " << result.cars << " cars, double "
+                  << result.millisecondsPerTick() << " ms per tick (checksum " << std::hex << result.checksum
+                  << std::dec << "), fixed " << fixed.millisecondsPerTick() << " ms per tick (checksum "
+                  << std::hex << fixed.checksum << std::dec << ")" << std::endl;
     }
+    return 0;
+}
 
 
-    //Handling crossing the finsh line
-    bool checkFinishLine() const {
-        return SDL_HasIntersection(&this->carRect, &finishLine);
-    }
-
-    void passedFinishLine() {
-        timesPassedFinishLine += 1;
-    }
+//Frame pacing numbers of the window loop, printed after it ends
+void printFramePacing(const FrameScheduler& scheduler) {
+    FramePacingStats stats = scheduler.getStats();
+    std::cout << "Frame pacing: " << pacingModeName(scheduler.getMode()) << " at " << scheduler.getRate() << " Hz"
+              << (scheduler.hasVsync() ? " with vsync" : "") << ", " << stats.frames << " frames" << std::endl;
+    std::cout << "Frame interval: " << stats.meanInterval * 1000.0 << " ms, jitter " << stats.intervalJitter * 1000.0
+              << " ms" << std::endl;
+    std::cout << "Wake error: " << stats.meanWakeError * 1000.0 << " ms (max " << stats.maxWakeError * 1000.0
+              << " ms), slept " << stats.sleepSeconds << " s, spun " << stats.spinSeconds << " s" << std::endl;
+}
 
-    int getTimesPassed() const {
-        return timesPassedFinishLine;
+//Window sized view of the world centred between the two players, kept inside the world
+SDL_Rect followPlayers(const RaceSnapshot& race, double alpha, const TrackLayout& layout) {
+    if (race.cars.size() < 2) return { 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT };
+    vect_t center = { { 0, 0 } };
+    for (size_t i = 0; i < 2; i++) {
+        const CarSnapshot& car = race.cars[i];
+        vect_t position = car.previousPosition + (car.position - car.previousPosition) * alpha;
+        center.v.x += (position.v.x + car.width / 2.0) / 2.0;
+        center.v.y += (position.v.y + car.height / 2.0) / 2.0;
     }
+    int x = static_cast<int>(center.v.x) - WINDOW_WIDTH / 2;
+    int y = static_cast<int>(center.v.y) - WINDOW_HEIGHT / 2;
+    return { std::min(std::max(x, 0), layout.width - WINDOW_WIDTH),
+             std::min(std::max(y, 0), layout.height - WINDOW_HEIGHT), WINDOW_WIDTH, WINDOW_HEIGHT };
+}
 
-    //Used to stop cars after they cross the finish line
-    void stop() {
-        velocity = {0, 0};
-        acceleration = {0, 0};
-        accelerationValue = 0.0;
+//Where the players will be in about half a second, the track around it is streamed in early
+std::vector<SDL_Point> streamingFocus(const RaceSnapshot& race) {
+    std::vector<SDL_Point> focus;
+    for (size_t i = 0; i < 2 && i < race.cars.size(); i++) {
+        const CarSnapshot& car = race.cars[i];
+        vect_t ahead = car.position + (car.position - car.previousPosition) * 60.0;
+        focus.push_back({ static_cast<int>(ahead.v.x) + car.width / 2, static_cast<int>(ahead.v.y) + car.height / 2 });
     }
-};
-
-//Print winner message for players
-void printWinner(SDL_Renderer* renderer, SDL_Texture* winnerTexture) {
-    SDL_Rect dstRect = { 0 , 0, WINDOW_WIDTH, WINDOW_HEIGHT };
-    SDL_RenderCopy(renderer, winnerTexture, nullptr, &dstRect);
+    return focus;
 }
 
+//Window game loop, returns the exit code. The asset cache lives in here so its
+//textures are destroyed before the renderer.
+int runGame(SDL_Renderer* renderer, const GameOptions& options) {
+    //Loading textures for cars, track and winner screens
+    AssetManager assets(renderer);
+    if (!assets.mountPack(ASSET_PACK_PATH)) {
+        std::cerr << "No asset pack at " << ASSET_PACK_PATH << ", decoding images instead" << std::endl;
+    }
+    std::vector<TextureHandle> textures = assets.preload(TEXTURE_MANIFEST);
+    if (!assets.finishLoading()) return 1;
 
-int main(int argc, char* argv[]) {
-    SDL_Window *window = nullptr;
-    SDL_Renderer *renderer = nullptr;
+    SDL_Texture *trackTexture = textures[0]->get();
+    SDL_Texture *car1Texture = textures[1]->get();
+    SDL_Texture *car2Texture = textures[2]->get();
+    SDL_Texture *winnerTexture = textures[3]->get();
 
-    if (!init(window, renderer)) {
-        std::cerr << "Failed to initialize SDL." << std::endl;
+    bool quit = false;
+    SDL_Event event;
+    const Uint8 *keys = SDL_GetKeyboardState(NULL);
+
+    //A replay drives the cars instead of the keyboard, at the rate and on the track it was recorded with
+    InputReplay replay;
+    bool replaying = !options.replayPath.empty();
+    if (replaying && !replay.load(options.replayPath)) return 1;
+    double physicsRate = replaying ? 1.0 / replay.getStep() : options.physicsRate;
+
+    TrackLayout layout = createTrackLayout(replaying ? replay.getTrackScale() : options.headlessOptions.trackScale);
+    std::shared_ptr<const TrackMap> track = loadTrackMap(layout);
+    if (!track) return 1;
+
+    // Create player cars, AI opponents line up behind them
+    size_t carCount = replaying ? replay.getCarCount() : 2 + options.opponents;
+    Simulation simulation(createStartingGrid(carCount, { car1Texture, car2Texture }, layout.scale), track,
+                          PhysicsParameters(), layout.timingLines);
+    InputRecorder recorder(carCount, 1.0 / physicsRate, layout.scale);
+    StateReplayWriter stateWriter;
+    if (!options.recordStatePath.empty() && !stateWriter.open(options.recordStatePath, carCount, 1.0 / physicsRate)) {
         return 1;
     }
+    WorkerPool workers(options.headlessOptions.threads);
+    AiDrivers aiDrivers(layout.waypoints, 2, &workers);
+
+    //Physics runs on its own thread at a fixed rate, independent of how often frames are presented
+    SimulationThread simulationThread(simulation, physicsRate, replaying ? &replay : nullptr,
+                                      options.recordPath.empty() ? nullptr : &recorder,
+                                      options.opponents > 0 ? &aiDrivers : nullptr,
+                                      stateWriter.isOpen() ? &stateWriter : nullptr);
+    simulationThread.start();
+
+    //Player cars of an earlier race, drawn see-through at the same tick as this one
+    StateReplayReader ghost;
+    bool showGhost = !options.ghostPath.empty() && ghost.open(options.ghostPath);
+    std::vector<CarPose> ghostPrevious;
+    //Controls last sent per player, keys are only sent when they change
+    CarInput sentInputs[2];
+    bool inputSent[2] = { false, false };
+
+    //A world larger than the window is streamed in chunks around the camera,
+    //the window sized track is a single copy of the track texture
+    std::unique_ptr<TrackStreamer> streamer;
+    if (layout.scale > 1) {
+        streamer = std::make_unique<TrackStreamer>(renderer, "resources/track.bmp", trackTexture, layout.width,
+                                                   layout.height, WINDOW_WIDTH, WINDOW_HEIGHT);
+    }
 
-    //Loading textures for cars and track
-    std::vector<SDL_Texture *> textures;
-    SDL_Texture *trackTexture = loadTexture("resources/track.bmp", renderer);
-    if (!trackTexture) return 1;
-    textures.push_back(trackTexture);
+    //The window sized track, stretched once instead of every frame
+    BackgroundLayer background(renderer, trackTexture);
 
-    SDL_Texture *car1Texture = loadTexture("resources/car1.bmp", renderer);
-    if (!car1Texture) return 1;
-    textures.push_back(car1Texture);
+    //All cars in one draw call through an atlas of their textures
+    SpriteBatch sprites(renderer, { car1Texture, car2Texture });
 
-    SDL_Texture *car2Texture = loadTexture("resources/car2.bmp", renderer);
-    if (!car2Texture) return 1;
-    textures.push_back(car2Texture);
+    //Performance overlay, toggled with F3
+    Hud hud(renderer);
+    Uint64 frameStart = SDL_GetPerformanceCounter();
 
-    SDL_Texture *winnerTexture = loadTexture("resources/winner1.bmp", renderer);
-    if (!winnerTexture) return 1;
-    textures.push_back(winnerTexture);
+    //Without vsync nothing else would stop the loop from drawing frames as fast as it can
+    SDL_RendererInfo rendererInfo;
+    bool vsync = SDL_GetRendererInfo(renderer, &rendererInfo) == 0 && (rendererInfo.flags & SDL_RENDERER_PRESENTVSYNC);
+    double frameRate = options.frameRate;
+    SDL_DisplayMode displayMode;
+    if (frameRate <= 0.0 && SDL_GetWindowDisplayMode(SDL_RenderGetWindow(renderer), &displayMode) == 0) {
+        frameRate = displayMode.refresh_rate;
+    }
+    FrameScheduler scheduler(options.pacing, frameRate > 0.0 ? frameRate : 60.0, vsync);
 
-    bool quit = false;
-    bool raceFinished = false;
-    SDL_Event event;
-    const Uint8 *keys = SDL_GetKeyboardState(NULL);;
 
-    // Create player cars
-    std::vector<Car> cars = {
-            Car(370, 60, car1Texture),
-            Car(370, 110, car2Texture)
+    //Player keys by car, an input sent for a car is dated by the newest event for its keys
+    const SDL_Scancode playerKeys[2][4] = {
+            { SDL_SCANCODE_W, SDL_SCANCODE_S, SDL_SCANCODE_A, SDL_SCANCODE_D },
+            { SDL_SCANCODE_UP, SDL_SCANCODE_DOWN, SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT }
     };
-
-    // 60 fps animation
-    double dt = 1. / 60.;
-
-
-    //Game loop
-    while (!quit) {
-        //Even loop
+    Uint64 lastKeyEvent[2] = { 0, 0 };
+    InputLatencyTracker latency;
+
+    //Reads events and queues changed controls for the simulation thread. Called at the top of
+    //the frame, while the scheduler holds the frame back and once more right before present,
+    //so a key press waits for the next tick instead of for the next frame.
+    auto pumpInput = [&]() {
+        MYGAME_PROFILE_ZONE("Events");
         while (SDL_PollEvent(&event)) {
 
             if (event.type == SDL_QUIT)
                 quit = true;
 
+            if (event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_F3 && !event.key.repeat)
+                hud.toggle();
+
+            if (PROFILER_ENABLED && event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_F12)
+                writeChromeTrace(options.tracePath);
+
+            if (event.type == SDL_RENDER_TARGETS_RESET) {
+                sprites.rebuild();
+                background.invalidate();
+            }
+
+            if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                background.invalidate();
+
+            if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && !event.key.repeat) {
+                for (size_t player = 0; player < 2; player++) {
+                    const SDL_Scancode* keysOfPlayer = playerKeys[player];
+                    if (std::find(keysOfPlayer, keysOfPlayer + 4, event.key.keysym.scancode) != keysOfPlayer + 4) {
+                        lastKeyEvent[player] = InputLatencyTracker::eventTime(event.key.timestamp);
+                    }
+                }
+            }
+
         }
 
-        cars[0].accelerate(0);
-        cars[0].decelerate(0);
-        cars[0].turnLeft(0);
-        cars[0].turnRight(0);
-        cars[1].accelerate(0);
-        cars[1].decelerate(0);
-        cars[1].turnLeft(0);
-        cars[1].turnLeft(0);
         //Key press handle for car movement
-        if (!raceFinished) {
-            if (keys[SDL_SCANCODE_W]) cars[0].accelerate(50.);
-            if (keys[SDL_SCANCODE_S]) cars[0].decelerate(50.);
-            if (keys[SDL_SCANCODE_A]) cars[0].turnLeft(1);
-            if (keys[SDL_SCANCODE_D]) cars[0].turnRight(1);
-            if (keys[SDL_SCANCODE_UP]) cars[1].accelerate(50.);
-            if (keys[SDL_SCANCODE_DOWN]) cars[1].decelerate(50.);
-            if (keys[SDL_SCANCODE_LEFT]) cars[1].turnLeft(1);
-            if (keys[SDL_SCANCODE_RIGHT]) cars[1].turnRight(1);
+        CarInput players[2];
+        for (uint32_t i = 0; i < 2; i++) {
+            players[i].accelerate = keys[playerKeys[i][0]];
+            players[i].decelerate = keys[playerKeys[i][1]];
+            players[i].turnLeft = keys[playerKeys[i][2]];
+            players[i].turnRight = keys[playerKeys[i][3]];
         }
 
+        for (uint32_t i = 0; i < 2; i++) {
+            if (inputSent[i] && packInput(players[i]) == packInput(sentInputs[i])) continue;
+            //A full queue leaves the change unsent, it is retried next time
+            if (simulationThread.sendInput(i, players[i])) {
+                //The first send is the neutral starting input, not something a player did
+                latency.inputSent(inputSent[i] ? lastKeyEvent[i] : 0);
+                sentInputs[i] = players[i];
+                inputSent[i] = true;
+            }
+        }
 
         if (keys[SDL_SCANCODE_ESCAPE]) quit = true;
+    };
 
+    //Game loop
+    while (!quit) {
+        MYGAME_PROFILE_ZONE("Frame");
+        scheduler.beginFrame(pumpInput);
 
+        //Uploads anything loaded after startup
+        {
+            MYGAME_PROFILE_ZONE("Asset upload");
+            assets.update();
+        }
 
+        pumpInput();
+
+        //Newest tick from the simulation thread, drawn part of the way towards the next one
+        Uint64 now = SDL_GetPerformanceCounter();
+        double frameTime = static_cast<double>(now - frameStart) / SDL_GetPerformanceFrequency();
+        frameStart = now;
+        hud.recordFrame(frameTime);
+
+        const RaceSnapshot& race = simulationThread.latest();
+        double sinceTick = std::chrono::duration<double>(std::chrono::steady_clock::now() - race.time).count();
+        double alpha = std::min(std::max(sinceTick / simulationThread.getStep(), 0.0), 1.0);
+        SDL_Rect view = followPlayers(race, alpha, layout);
+        int renderCommands = 0;
+
+        // Clear screen and draw track
+        {
+            MYGAME_PROFILE_ZONE("Draw track");
+            if (streamer) {
+                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+                SDL_RenderClear(renderer);
+                streamer->update(view, streamingFocus(race));
+                renderCommands += 1 + streamer->draw(view);
+            } else {
+                //Covers every pixel, so no clear first
+                renderCommands += background.draw();
+            }
+        }
 
-        // Clear screen
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-
-        // Draw track
-        SDL_RenderCopy(renderer, trackTexture, nullptr, nullptr);
-
-        // Update cars
-        for (auto &car: cars) {
-            car.update(dt);
+        if (race.raceFinished) {
+            winnerTexture = textures[race.winner == 0 ? 3 : 4]->get();
         }
 
-        //Checking if player passed the finish line 2 lines
-        //-> using bigger value due to the amount of collision between rects
-        if (!raceFinished) {
-            if (cars[0].checkFinishLine()) {
-                if (cars[0].getTimesPassed() < 2) {
-                    cars[0].passedFinishLine();
-                } else {
-                    raceFinished = true;
-                    winnerTexture = loadTexture("resources/winner1.bmp", renderer);
-                    if (!winnerTexture) return 1;
-                    textures.push_back(winnerTexture);
-                    for (auto &car: cars) car.stop();
-                }
+        if (showGhost) {
+            MYGAME_PROFILE_ZONE("Draw ghost");
+            uint64_t tick = std::min<uint64_t>(race.tick, ghost.getTickCount() - 1);
+            if (tick != ghost.frame().tick) {
+                //During a race the ghost moves one tick at a time, anything else is a seek
+                if (tick != ghost.frame().tick + 1) ghost.seek(tick > 0 ? tick - 1 : 0);
+                ghostPrevious = ghost.frame().cars;
+                if (tick > 0) ghost.next();
             }
-            if (cars[1].checkFinishLine()) {
-                if (cars[1].getTimesPassed() < 40) {
-                    cars[1].passedFinishLine();
+            for (size_t i = 0; i < 2 && i < ghost.getCarCount() && i < race.cars.size(); i++) {
+                const CarPose& pose = ghost.frame().cars[i];
+                const CarPose& before = ghostPrevious.empty() ? pose : ghostPrevious[i];
+                CarSnapshot car = race.cars[i];
+                car.position = { { pose.x, pose.y } };
+                car.previousPosition = { { before.x, before.y } };
+                car.angle = pose.angle;
+                car.previousAngle = before.angle;
+                if (sprites.isReady()) {
+                    sprites.add(car, alpha, view, 96);
                 } else {
-                    raceFinished = true;
-                    winnerTexture = loadTexture("resources/winner2.bmp", renderer);
-                    if (!winnerTexture) return 1;
-                    textures.push_back(winnerTexture);
-                    for (auto &car: cars) car.stop();
+                    SDL_SetTextureAlphaMod(car.texture, 96);
+                    if (drawCar(renderer, car, alpha, view)) renderCommands++;
+                    SDL_SetTextureAlphaMod(car.texture, 255);
                 }
             }
         }
 
-        //Collision checking for both cars
-        if (cars[0].checkCollision(cars[1])) {
-            cars[0].handleCollision(cars[1]);
-        }
-        if (cars[1].checkCollision(cars[0])) {
-            cars[1].handleCollision(cars[0]);
-        }
-
         //Rendering cars
-        for (auto &car: cars) {
-            car.draw(renderer);
+        {
+            MYGAME_PROFILE_ZONE("Draw cars");
+            //Cars outside the view are culled, the rest go out in one batch after the ghost
+            for (const CarSnapshot &car: race.cars) {
+                if (sprites.isReady()) sprites.add(car, alpha, view);
+                else if (drawCar(renderer, car, alpha, view)) renderCommands++;
+            }
+            renderCommands += sprites.flush();
         }
 
+        //Everything drawn so far and the overlay itself
+        HudStats hudStats;
+        hudStats.ticks = race.tick;
+        hudStats.cars = race.cars.size();
+        hudStats.renderCommands = renderCommands + 1;
+        hud.draw(hudStats);
+
         //Print winner message
-        if (raceFinished) {
+        if (race.raceFinished) {
+            MYGAME_PROFILE_ZONE("Draw winner");
             printWinner(renderer, winnerTexture);
         }
 
         // Update screen
-        SDL_RenderPresent(renderer);
+        {
+            //Anything pressed while drawing still makes the next tick
+            pumpInput();
+            MYGAME_PROFILE_ZONE("SDL_RenderPresent");
+            scheduler.beginPresent();
+            Uint64 presentStart = SDL_GetPerformanceCounter();
+            SDL_RenderPresent(renderer);
+            Uint64 presentEnd = SDL_GetPerformanceCounter();
+            scheduler.endFrame();
+            latency.framePresented(race.inputsApplied, presentStart, presentEnd);
+        }
 
     }
 
-
-    cleanup(window, renderer, textures);
+    simulationThread.stop();
+    printFramePacing(scheduler);
+    latency.print(std::cout);
+    if (PROFILER_ENABLED) writeChromeTrace(options.tracePath);
+    if (!options.recordPath.empty() && !recorder.save(options.recordPath)) return 1;
+    if (!stateWriter.close()) return 1;
     return 0;
-}
\ No newline at end of file
+}
+
+
+int main(int argc, char* argv[]) {
+    GameOptions options = parseOptions(argc, argv);
+    if (options.headless && options.stressCars > 0) {
+        return runStressMode(options.stressCars, options.headlessOptions);
+    }
+    //Every car needs its own slot on the starting grid
+    size_t gridCars = maxStartingGridCars(options.headlessOptions.trackScale);
+    if (options.headlessOptions.cars > gridCars || options.opponents + 2 > gridCars) {
+        std::cerr << "At most " << gridCars << " cars fit on the starting grid at track scale "
+                  << options.headlessOptions.trackScale << std::endl;
+        return 1;
+    }
+    if (options.headless && !options.stateReplayPath.empty()) {
+        return runStateReplayMode(options);
+    }
+    if (options.headless && options.netplay) {
+        return runNetplayMode(options);
+    }
+    if (options.headless && !options.sweepPath.empty()) {
+        return runSweepMode(options);
+    }
+    if (options.headless && !options.replayPath.empty()) {
+        return runReplayMode(options);
+    }
+    if (options.headless) {
+        return runHeadlessMode(options);
+    }
+
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+
+    if (!init(window, renderer)) {
+        std::cerr << "Failed to initialize SDL." << std::endl;
+        return 1;
+    }
+
+    int result = runGame(renderer, options);
+    cleanup(window, renderer);
+    return result;
+}
@@ -0,0 +1,41 @@
+#ifndef MYGAME_MAPPED_FILE_H
+#define MYGAME_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+//Read only memory mapping of a whole file. Pages are only read from disk when they are
+//first touched, so opening a large file costs the same as opening a small one.
+class MappedFile {
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int file = -1;
+#endif
+
+public:
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //False for missing and empty files, errors are left to the caller to report
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return bytes != nullptr; }
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+#endif //MYGAME_MAPPED_FILE_H
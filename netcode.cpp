@@ -0,0 +1,192 @@
+#include "netcode.h"
+#include "profiler.h"
+#include "replay.h"
+#include "track_layout.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+
+//Packet layout, little endian: InputPacketHeader, then count bytes of controls
+//packed like the replay format, for the ticks from firstTick on
+struct InputPacketHeader {
+    uint64_t firstTick;
+    //The sender has the receiver's controls for every tick before this one
+    uint64_t acknowledged;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+}
+
+
+LoopbackNetwork::LoopbackNetwork(double latency, double lossRate, uint32_t seed)
+    : latency(latency), lossRate(lossRate), random(seed), endpoints{ Endpoint(*this, 0), Endpoint(*this, 1) } {}
+
+void LoopbackNetwork::Endpoint::send(const std::vector<uint8_t>& packet) {
+    network.sent++;
+    network.random = network.random * 1664525u + 1013904223u;
+    if ((network.random >> 8) / 16777216.0 < network.lossRate) {
+        network.lost++;
+        return;
+    }
+    //Constant latency keeps packets in order, so each direction is a plain queue
+    network.inFlight[1 - side].push_back({ network.now + network.latency, packet });
+}
+
+bool LoopbackNetwork::Endpoint::receive(std::vector<uint8_t>& packet) {
+    std::deque<Packet>& queue = network.inFlight[side];
+    if (queue.empty() || queue.front().arrival > network.now) return false;
+    packet.swap(queue.front().data);
+    queue.pop_front();
+    return true;
+}
+
+
+RollbackSession::RollbackSession(Simulation& simulation, Transport& transport, size_t localCar, size_t remoteCar,
+                                 double step)
+    : simulation(simulation), transport(transport), localCar(localCar), remoteCar(remoteCar), step(step) {
+    localInputs.fill(CarInput());
+    remoteInputs.fill(CarInput());
+    usedRemoteInputs.fill(CarInput());
+}
+
+CarInput RollbackSession::remoteInputFor(uint64_t tick) const {
+    if (tick < remoteConfirmed) return remoteInputs[tick % INPUT_HISTORY];
+    //Players hold keys for many ticks, repeating the last known controls is usually right
+    return remoteConfirmed > 0 ? remoteInputs[(remoteConfirmed - 1) % INPUT_HISTORY] : CarInput();
+}
+
+void RollbackSession::stepTick() {
+    uint64_t tick = simulation.getTick();
+    simulation.saveState(states[tick % states.size()]);
+    CarInput remote = remoteInputFor(tick);
+    usedRemoteInputs[tick % INPUT_HISTORY] = remote;
+    simulation.setInput(localCar, localInputs[tick % INPUT_HISTORY]);
+    simulation.setInput(remoteCar, remote);
+    simulation.step(step);
+}
+
+void RollbackSession::sendInputs() {
+    uint64_t end = simulation.getTick();
+    uint64_t first = std::max(localAcknowledged, end > MAX_PACKET_INPUTS ? end - MAX_PACKET_INPUTS : 0);
+    InputPacketHeader header = { first, remoteConfirmed, static_cast<uint32_t>(end - first), 0 };
+
+    packet.resize(sizeof(header) + header.count);
+    std::memcpy(packet.data(), &header, sizeof(header));
+    for (uint64_t tick = first; tick < end; tick++) {
+        packet[sizeof(header) + (tick - first)] = packInput(localInputs[tick % INPUT_HISTORY]);
+    }
+    transport.send(packet);
+}
+
+void RollbackSession::poll() {
+    uint64_t current = simulation.getTick();
+    uint64_t rollbackTo = UINT64_MAX;
+
+    while (transport.receive(packet)) {
+        InputPacketHeader header;
+        if (packet.size() < sizeof(header)) continue;
+        std::memcpy(&header, packet.data(), sizeof(header));
+        if (packet.size() != sizeof(header) + header.count) continue;
+
+        if (header.acknowledged <= current) localAcknowledged = std::max(localAcknowledged, header.acknowledged);
+        //Only the next unknown tick extends the confirmed controls, older ones are repeats
+        for (uint64_t i = 0; i < header.count; i++) {
+            uint64_t tick = header.firstTick + i;
+            if (tick != remoteConfirmed) continue;
+            if (tick >= current + INPUT_HISTORY - MAX_ROLLBACK_TICKS) break;
+            CarInput input = unpackInput(packet[sizeof(header) + i]);
+            remoteInputs[tick % INPUT_HISTORY] = input;
+            if (tick < current && packInput(input) != packInput(usedRemoteInputs[tick % INPUT_HISTORY])) {
+                rollbackTo = std::min(rollbackTo, tick);
+            }
+            remoteConfirmed++;
+        }
+    }
+
+    if (rollbackTo != UINT64_MAX) {
+        MYGAME_PROFILE_ZONE("Rollback");
+        auto start = std::chrono::steady_clock::now();
+        simulation.restoreState(states[rollbackTo % states.size()]);
+        while (simulation.getTick() < current) stepTick();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        stats.rollbacks++;
+        stats.resimulatedTicks += current - rollbackTo;
+        stats.maxResimulatedTicks = std::max(stats.maxResimulatedTicks, current - rollbackTo);
+        stats.maxRollbackSeconds = std::max(stats.maxRollbackSeconds, seconds);
+    }
+
+    if (!canAdvance()) stats.stalls++;
+    //Sent even with nothing new, a stalled player still has to acknowledge and resend
+    sendInputs();
+}
+
+void RollbackSession::advance(const CarInput& input) {
+    uint64_t tick = simulation.getTick();
+    localInputs[tick % INPUT_HISTORY] = input;
+    stepTick();
+    sendInputs();
+}
+
+
+NetplayResult runLoopbackRace(const HeadlessOptions& options, std::shared_ptr<const TrackMap> track,
+                              double latency, double lossRate) {
+    NetplayResult result;
+    auto start = std::chrono::steady_clock::now();
+
+    //The same race with the real controls of both players on every tick
+    TrackLayout layout = createTrackLayout(options.trackScale);
+    Simulation reference(createPlayerCars(nullptr, nullptr, layout.scale), track, PhysicsParameters(), layout.timingLines);
+    ScriptedDriver referenceDrivers[2] = { ScriptedDriver(options.seed, options.dt),
+                                           ScriptedDriver(options.seed + 104729u, options.dt) };
+    while (!reference.isRaceFinished() && reference.getTick() < options.maxTicks) {
+        for (size_t car = 0; car < 2; car++) {
+            reference.setInput(car, referenceDrivers[car].drive(reference.getTick()));
+        }
+        reference.step(options.dt);
+    }
+    result.ticks = reference.getTick();
+    result.referenceChecksum = reference.checksum();
+
+    LoopbackNetwork network(latency, lossRate, options.seed);
+    Simulation first(createPlayerCars(nullptr, nullptr, layout.scale), track, PhysicsParameters(), layout.timingLines);
+    Simulation second(createPlayerCars(nullptr, nullptr, layout.scale), track, PhysicsParameters(), layout.timingLines);
+    RollbackSession firstSession(first, network.endpoint(0), 0, 1, options.dt);
+    RollbackSession secondSession(second, network.endpoint(1), 1, 0, options.dt);
+    RollbackSession* sessions[2] = { &firstSession, &secondSession };
+    ScriptedDriver drivers[2] = { ScriptedDriver(options.seed, options.dt),
+                                  ScriptedDriver(options.seed + 104729u, options.dt) };
+
+    //One tick per frame, frames go on until both players have confirmed the whole race.
+    //The frame limit only matters when nearly every packet is lost.
+    uint64_t frameLimit = result.ticks * 100 + 100000;
+    for (uint64_t frame = 0; frame < frameLimit; frame++) {
+        bool done = true;
+        for (RollbackSession* session : sessions) {
+            done = done && session->getTick() == result.ticks && session->isConfirmed();
+        }
+        if (done) break;
+
+        network.advance(options.dt);
+        for (size_t player = 0; player < 2; player++) {
+            RollbackSession& session = *sessions[player];
+            session.poll();
+            if (session.getTick() < result.ticks && session.canAdvance()) {
+                session.advance(drivers[player].drive(session.getTick()));
+            }
+        }
+    }
+
+    result.checksums[0] = first.checksum();
+    result.checksums[1] = second.checksum();
+    result.stats[0] = firstSession.getStats();
+    result.stats[1] = secondSession.getStats();
+    result.packetsSent = network.getSent();
+    result.packetsLost = network.getLost();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
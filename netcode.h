@@ -0,0 +1,172 @@
+#ifndef MYGAME_NETCODE_H
+#define MYGAME_NETCODE_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "simulation.h"
+
+
+//Unreliable datagram link to the other player: packets may be lost but arrive whole.
+//A UDP socket fits behind it as well as the in-process loopback below.
+class Transport {
+
+public:
+
+    virtual ~Transport() = default;
+
+    virtual void send(const std::vector<uint8_t>& packet) = 0;
+
+    //Next packet that has arrived, false when there is none yet
+    virtual bool receive(std::vector<uint8_t>& packet) = 0;
+};
+
+//Two connected in-process endpoints with a fixed one way latency and random loss.
+//Time is advanced by the owner, so a loopback race is reproducible. Single threaded.
+class LoopbackNetwork {
+
+private:
+    struct Packet {
+        double arrival;
+        std::vector<uint8_t> data;
+    };
+
+    class Endpoint : public Transport {
+
+    private:
+        LoopbackNetwork& network;
+        size_t side;
+
+    public:
+        Endpoint(LoopbackNetwork& network, size_t side) : network(network), side(side) {}
+        void send(const std::vector<uint8_t>& packet) override;
+        bool receive(std::vector<uint8_t>& packet) override;
+    };
+
+    double latency;
+    double lossRate;
+    uint32_t random;
+    double now = 0.0;
+    //Packets on their way to each side
+    std::deque<Packet> inFlight[2];
+    Endpoint endpoints[2];
+    uint64_t sent = 0;
+    uint64_t lost = 0;
+
+public:
+
+    //latency in seconds each way, lossRate in [0, 1]
+    LoopbackNetwork(double latency, double lossRate, uint32_t seed = 1);
+
+    LoopbackNetwork(const LoopbackNetwork&) = delete;
+    LoopbackNetwork& operator=(const LoopbackNetwork&) = delete;
+
+    Transport& endpoint(size_t side) { return endpoints[side]; }
+
+    void advance(double seconds) { now += seconds; }
+
+    uint64_t getSent() const { return sent; }
+    uint64_t getLost() const { return lost; }
+};
+
+
+struct RollbackStats {
+    uint64_t rollbacks = 0;
+    uint64_t resimulatedTicks = 0;
+    uint64_t maxResimulatedTicks = 0;
+    //Frames the session could not advance because the other player was too far behind
+    uint64_t stalls = 0;
+    //Longest restore and re-simulation, it has to fit in one frame
+    double maxRollbackSeconds = 0.0;
+};
+
+//Rollback netcode for two players, each running their own identical Simulation.
+//Local controls are applied at once and the remote player's controls are predicted
+//to stay what they were last. When the real ones arrive and differ, the simulation is
+//restored to the first mispredicted tick and stepped forward again. Every packet
+//carries all local controls the other side has not acknowledged, so lost packets
+//only delay them.
+class RollbackSession {
+
+public:
+
+    //Ticks the session may run ahead of the last confirmed remote controls
+    static constexpr uint64_t MAX_ROLLBACK_TICKS = 8;
+
+private:
+    //Controls kept per player, a power of two larger than any unacknowledged span
+    static constexpr uint64_t INPUT_HISTORY = 64;
+    static constexpr uint64_t MAX_PACKET_INPUTS = 32;
+
+    Simulation& simulation;
+    Transport& transport;
+    size_t localCar;
+    size_t remoteCar;
+    double step;
+
+    std::array<CarInput, INPUT_HISTORY> localInputs;
+    std::array<CarInput, INPUT_HISTORY> remoteInputs;
+    //Remote controls the simulation was stepped with, real or predicted
+    std::array<CarInput, INPUT_HISTORY> usedRemoteInputs;
+    //State at the start of each tick that may still be rolled back to
+    std::array<SimulationState, MAX_ROLLBACK_TICKS + 1> states;
+
+    //Remote controls are known for every tick before this one
+    uint64_t remoteConfirmed = 0;
+    //The other side has all local controls before this tick
+    uint64_t localAcknowledged = 0;
+    std::vector<uint8_t> packet;
+    RollbackStats stats;
+
+    CarInput remoteInputFor(uint64_t tick) const;
+    void stepTick();
+    void sendInputs();
+
+public:
+
+    //The simulation holds the two player cars at localCar and remoteCar and has not been
+    //stepped yet. Both players must start from identical simulations.
+    RollbackSession(Simulation& simulation, Transport& transport, size_t localCar, size_t remoteCar, double step);
+
+    //Receives remote controls, rolls back and re-simulates if a prediction was wrong,
+    //then sends the local controls the other side is missing. Call once per frame.
+    void poll();
+
+    //False while the next tick would be more than MAX_ROLLBACK_TICKS ahead of the remote player
+    bool canAdvance() const { return simulation.getTick() < remoteConfirmed + MAX_ROLLBACK_TICKS; }
+
+    //Steps one tick with the local controls, only when canAdvance()
+    void advance(const CarInput& input);
+
+    //True once every tick stepped so far used the real remote controls
+    bool isConfirmed() const { return remoteConfirmed >= simulation.getTick(); }
+
+    uint64_t getTick() const { return simulation.getTick(); }
+    const RollbackStats& getStats() const { return stats; }
+};
+
+
+struct NetplayResult {
+    uint64_t ticks = 0;
+    //Checksums of both players' simulations and of one stepped with the real controls
+    uint64_t checksums[2] = {};
+    uint64_t referenceChecksum = 0;
+    RollbackStats stats[2];
+    uint64_t packetsSent = 0;
+    uint64_t packetsLost = 0;
+    double seconds = 0.0;
+
+    bool inSync() const { return checksums[0] == referenceChecksum && checksums[1] == referenceChecksum; }
+};
+
+//Two scripted players racing each other through rollback sessions over a loopback
+//network, one tick per frame, compared against the same race without a network
+NetplayResult runLoopbackRace(const HeadlessOptions& options, std::shared_ptr<const TrackMap> track,
+                              double latency, double lossRate);
+
+#endif //MYGAME_NETCODE_H
@@ -0,0 +1,166 @@
+#include "obb.h"
+
+#include <cmath>
+
+
+SDL_Rect boundingRect(const OrientedBox& box) {
+    double extentX = std::fabs(box.axisX) * box.halfLength + std::fabs(box.axisY) * box.halfWidth;
+    double extentY = std::fabs(box.axisY) * box.halfLength + std::fabs(box.axisX) * box.halfWidth;
+    int left = static_cast<int>(std::floor(box.centerX - extentX));
+    int top = static_cast<int>(std::floor(box.centerY - extentY));
+    int right = static_cast<int>(std::ceil(box.centerX + extentX));
+    int bottom = static_cast<int>(std::ceil(box.centerY + extentY));
+    return { left, top, right - left, bottom - top };
+}
+
+
+namespace {
+
+struct BatchArrays {
+    const double* acx; const double* acy; const double* aux; const double* auy; const double* ahw; const double* ahl;
+    const double* bcx; const double* bcy; const double* bux; const double* buy; const double* bhw; const double* bhl;
+    double* nx; double* ny; double* depth;
+};
+
+//For two boxes the four candidate axes are the length and width axis of each. With
+//c and s the cosine and sine between the headings, the projected radius of a box
+//on the other box's axes only needs |c| and |s|. The axis with the least overlap
+//gives the contact normal; any overlap <= 0 means the pair is separated.
+void testScalar(const BatchArrays& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        double dx = a.bcx[i] - a.acx[i];
+        double dy = a.bcy[i] - a.acy[i];
+        double c = std::fabs(a.aux[i] * a.bux[i] + a.auy[i] * a.buy[i]);
+        double s = std::fabs(a.aux[i] * a.buy[i] - a.auy[i] * a.bux[i]);
+
+        double axes[4][2] = {
+            { a.aux[i], a.auy[i] },
+            { -a.auy[i], a.aux[i] },
+            { a.bux[i], a.buy[i] },
+            { -a.buy[i], a.bux[i] }
+        };
+        double radii[4] = {
+            a.ahl[i] + a.bhl[i] * c + a.bhw[i] * s,
+            a.ahw[i] + a.bhl[i] * s + a.bhw[i] * c,
+            a.bhl[i] + a.ahl[i] * c + a.ahw[i] * s,
+            a.bhw[i] + a.ahl[i] * s + a.ahw[i] * c
+        };
+
+        double best = 0.0, bestX = 0.0, bestY = 0.0;
+        for (int k = 0; k < 4; k++) {
+            double projection = dx * axes[k][0] + dy * axes[k][1];
+            double overlap = radii[k] - std::fabs(projection);
+            double direction = projection < 0 ? -1.0 : 1.0;
+            if (k == 0 || overlap < best) {
+                best = overlap;
+                bestX = axes[k][0] * direction;
+                bestY = axes[k][1] * direction;
+            }
+        }
+        a.nx[i] = bestX;
+        a.ny[i] = bestY;
+        a.depth[i] = best;
+    }
+}
+
+#if defined(MYGAME_SSE2)
+size_t testSSE2(const BatchArrays& a, size_t count) {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d minusOne = _mm_set1_pd(-1.0);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d aux = _mm_loadu_pd(a.aux + i), auy = _mm_loadu_pd(a.auy + i);
+        __m128d bux = _mm_loadu_pd(a.bux + i), buy = _mm_loadu_pd(a.buy + i);
+        __m128d ahw = _mm_loadu_pd(a.ahw + i), ahl = _mm_loadu_pd(a.ahl + i);
+        __m128d bhw = _mm_loadu_pd(a.bhw + i), bhl = _mm_loadu_pd(a.bhl + i);
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(a.bcx + i), _mm_loadu_pd(a.acx + i));
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(a.bcy + i), _mm_loadu_pd(a.acy + i));
+        __m128d c = _mm_andnot_pd(sign, _mm_add_pd(_mm_mul_pd(aux, bux), _mm_mul_pd(auy, buy)));
+        __m128d s = _mm_andnot_pd(sign, _mm_sub_pd(_mm_mul_pd(aux, buy), _mm_mul_pd(auy, bux)));
+
+        __m128d axisX[4] = { aux, _mm_xor_pd(auy, sign), bux, _mm_xor_pd(buy, sign) };
+        __m128d axisY[4] = { auy, aux, buy, bux };
+        //Summed left to right like testScalar, so both give the same bits
+        __m128d radii[4] = {
+            _mm_add_pd(_mm_add_pd(ahl, _mm_mul_pd(bhl, c)), _mm_mul_pd(bhw, s)),
+            _mm_add_pd(_mm_add_pd(ahw, _mm_mul_pd(bhl, s)), _mm_mul_pd(bhw, c)),
+            _mm_add_pd(_mm_add_pd(bhl, _mm_mul_pd(ahl, c)), _mm_mul_pd(ahw, s)),
+            _mm_add_pd(_mm_add_pd(bhw, _mm_mul_pd(ahl, s)), _mm_mul_pd(ahw, c))
+        };
+
+        __m128d best = _mm_setzero_pd(), bestX = _mm_setzero_pd(), bestY = _mm_setzero_pd();
+        for (int k = 0; k < 4; k++) {
+            __m128d projection = _mm_add_pd(_mm_mul_pd(dx, axisX[k]), _mm_mul_pd(dy, axisY[k]));
+            __m128d overlap = _mm_sub_pd(radii[k], _mm_andnot_pd(sign, projection));
+            //-1 where the projection is below zero, else +1, so the normal points from a to b.
+            //A compare rather than the sign bit, -0.0 has to give +1 as in testScalar.
+            __m128d negative = _mm_cmplt_pd(projection, _mm_setzero_pd());
+            __m128d direction = _mm_or_pd(_mm_and_pd(negative, minusOne), _mm_andnot_pd(negative, one));
+            __m128d nx = _mm_mul_pd(axisX[k], direction);
+            __m128d ny = _mm_mul_pd(axisY[k], direction);
+            if (k == 0) {
+                best = overlap;
+                bestX = nx;
+                bestY = ny;
+            } else {
+                __m128d smaller = _mm_cmplt_pd(overlap, best);
+                best = _mm_min_pd(overlap, best);
+                bestX = _mm_or_pd(_mm_and_pd(smaller, nx), _mm_andnot_pd(smaller, bestX));
+                bestY = _mm_or_pd(_mm_and_pd(smaller, ny), _mm_andnot_pd(smaller, bestY));
+            }
+        }
+        _mm_storeu_pd(a.nx + i, bestX);
+        _mm_storeu_pd(a.ny + i, bestY);
+        _mm_storeu_pd(a.depth + i, best);
+    }
+    return i;
+}
+#endif
+
+}
+
+
+void BoxPairBatch::clear() {
+    for (auto* array : { &aCenterX, &aCenterY, &aAxisX, &aAxisY, &aHalfWidth, &aHalfLength,
+                         &bCenterX, &bCenterY, &bAxisX, &bAxisY, &bHalfWidth, &bHalfLength }) {
+        array->clear();
+    }
+}
+
+void BoxPairBatch::add(const OrientedBox& a, const OrientedBox& b) {
+    aCenterX.push_back(a.centerX);
+    aCenterY.push_back(a.centerY);
+    aAxisX.push_back(a.axisX);
+    aAxisY.push_back(a.axisY);
+    aHalfWidth.push_back(a.halfWidth);
+    aHalfLength.push_back(a.halfLength);
+    bCenterX.push_back(b.centerX);
+    bCenterY.push_back(b.centerY);
+    bAxisX.push_back(b.axisX);
+    bAxisY.push_back(b.axisY);
+    bHalfWidth.push_back(b.halfWidth);
+    bHalfLength.push_back(b.halfLength);
+}
+
+void BoxPairBatch::test(SimdLevel level) {
+    size_t count = size();
+    normalX.resize(count);
+    normalY.resize(count);
+    depth.resize(count);
+
+    BatchArrays arrays = {
+            aCenterX.data(), aCenterY.data(), aAxisX.data(), aAxisY.data(), aHalfWidth.data(), aHalfLength.data(),
+            bCenterX.data(), bCenterY.data(), bAxisX.data(), bAxisY.data(), bHalfWidth.data(), bHalfLength.data(),
+            normalX.data(), normalY.data(), depth.data()
+    };
+
+    size_t done = 0;
+    (void)level;
+#if defined(MYGAME_SSE2)
+    //Two doubles per lane already covers the handful of touching pairs per tick, AVX2 uses the same path
+    if (level != SimdLevel::Scalar) done = testSSE2(arrays, count);
+#endif
+    testScalar(arrays, done, count);
+}
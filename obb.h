@@ -0,0 +1,61 @@
+#ifndef MYGAME_OBB_H
+#define MYGAME_OBB_H
+
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "simd.h"
+
+
+//Car rectangle rotated by its heading, the shape SDL_RenderCopyEx actually draws
+struct OrientedBox {
+    double centerX;
+    double centerY;
+    //Unit vector along the length of the box (the heading)
+    double axisX;
+    double axisY;
+    double halfWidth;
+    double halfLength;
+};
+
+//Axis aligned rect that encloses the box, for the broadphase
+SDL_Rect boundingRect(const OrientedBox& box);
+
+struct Contact {
+    //Unit vector pointing from the first box towards the second
+    double normalX;
+    double normalY;
+    //How far the boxes have to move apart along the normal to stop touching
+    double depth;
+};
+
+//Separating axis test for a batch of box pairs. Boxes are stored as arrays so the
+//four axis tests run on several pairs per instruction without branches.
+class BoxPairBatch {
+
+private:
+    //First box of each pair
+    std::vector<double> aCenterX, aCenterY, aAxisX, aAxisY, aHalfWidth, aHalfLength;
+    //Second box of each pair
+    std::vector<double> bCenterX, bCenterY, bAxisX, bAxisY, bHalfWidth, bHalfLength;
+    std::vector<double> normalX, normalY, depth;
+
+public:
+
+    void clear();
+
+    void add(const OrientedBox& a, const OrientedBox& b);
+
+    size_t size() const { return aCenterX.size(); }
+
+    //Runs the test on every pair added since the last clear()
+    void test(SimdLevel level);
+
+    //Results of the last test(), pairs only touch when the depth is positive
+    bool isTouching(size_t pair) const { return depth[pair] > 0.0; }
+    Contact getContact(size_t pair) const { return { normalX[pair], normalY[pair], depth[pair] }; }
+};
+
+#endif //MYGAME_OBB_H
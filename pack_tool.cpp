@@ -0,0 +1,20 @@
+#include <SDL2/SDL.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+
+
+//Build tool: mygame_pack <output.pack> <image.bmp>...
+//Images are stored under the paths given, so run it from the directory the game runs in
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: mygame_pack <output.pack> <image.bmp>..." << std::endl;
+        return 1;
+    }
+    std::vector<std::string> paths(argv + 2, argv + argc);
+    if (!writeAssetPack(argv[1], paths)) return 1;
+    std::cout << "Packed " << paths.size() << " images into " << argv[1] << std::endl;
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace {
+
+struct ProfileEvent {
+    const char* name;
+    Uint64 start;
+    Uint64 end;
+};
+
+//One ring entry. The fields are relaxed atomics so a dump can read a slot while its thread
+//overwrites it; sequence is the event number plus one once the fields hold that event and
+//0 while they are being written, so a reader keeps only copies it saw unchanged.
+struct ProfileSlot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<Uint64> start{0};
+    std::atomic<Uint64> end{0};
+};
+
+//Zones kept per thread, a power of two so the index wraps with a mask
+constexpr size_t PROFILE_BUFFER_SIZE = 1 << 16;
+
+//Single writer ring buffer. The write count is published with release order after
+//each event, so a reader knows which events the slots can hold.
+struct ProfileBuffer {
+    std::vector<ProfileSlot> events;
+    std::atomic<uint64_t> written{0};
+    uint32_t threadId;
+
+    explicit ProfileBuffer(uint32_t threadId) : events(PROFILE_BUFFER_SIZE), threadId(threadId) {}
+};
+
+//Buffers outlive their threads so zones of finished workers can still be dumped.
+//The lock is only taken when a thread records its first zone and while dumping.
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ProfileBuffer>> registry;
+
+ProfileBuffer* threadBuffer() {
+    thread_local ProfileBuffer* buffer = nullptr;
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(std::make_unique<ProfileBuffer>(static_cast<uint32_t>(registry.size() + 1)));
+        buffer = registry.back().get();
+    }
+    return buffer;
+}
+
+void writeJsonString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+}
+
+
+void recordProfileZone(const char* name, Uint64 start, Uint64 end) {
+    ProfileBuffer* buffer = threadBuffer();
+    uint64_t index = buffer->written.load(std::memory_order_relaxed);
+    ProfileSlot& slot = buffer->events[index & (PROFILE_BUFFER_SIZE - 1)];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+bool writeChromeTrace(const std::string& path) {
+    //Copy the live part of every ring first so the file is written without holding the lock
+    std::vector<std::pair<uint32_t, ProfileEvent>> events;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& buffer : registry) {
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            uint64_t first = written > PROFILE_BUFFER_SIZE ? written - PROFILE_BUFFER_SIZE : 0;
+            for (uint64_t i = first; i < written; i++) {
+                const ProfileSlot& slot = buffer->events[i & (PROFILE_BUFFER_SIZE - 1)];
+                if (slot.sequence.load(std::memory_order_acquire) != i + 1) continue;
+                ProfileEvent event = { slot.name.load(std::memory_order_relaxed),
+                                       slot.start.load(std::memory_order_relaxed),
+                                       slot.end.load(std::memory_order_relaxed) };
+                //The thread wrapped around onto this slot while it was copied
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) != i + 1) continue;
+                events.emplace_back(buffer->threadId, event);
+            }
+        }
+    }
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Unable to write trace " << path << std::endl;
+        return false;
+    }
+
+    Uint64 origin = UINT64_MAX;
+    for (const auto& event : events) origin = std::min(origin, event.second.start);
+    double microseconds = 1e6 / static_cast<double>(SDL_GetPerformanceFrequency());
+
+    file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); i++) {
+        const ProfileEvent& event = events[i].second;
+        file << (i > 0 ? ",\n" : "\n") << "{\"name\":";
+        writeJsonString(file, event.name);
+        file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << events[i].first
+             << ",\"ts\":" << (event.start - origin) * microseconds
+             << ",\"dur\":" << (event.end - event.start) * microseconds << "}";
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    if (!file) {
+        std::cerr << "Unable to write trace " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef MYGAME_PROFILER_H
+#define MYGAME_PROFILER_H
+
+#include <SDL2/SDL.h>
+#include <string>
+
+
+//Scoped timing zones, compiled in with -DMYGAME_PROFILE=ON. Without it the zone macro
+//expands to nothing and no timer is read.
+//
+//  void Simulation::step(double dt) {
+//      MYGAME_PROFILE_ZONE("Simulation::step");
+//      ...
+//
+//Zone names must be string literals, only the pointer is stored.
+#ifdef MYGAME_PROFILE
+#define MYGAME_PROFILE_JOIN2(a, b) a##b
+#define MYGAME_PROFILE_JOIN(a, b) MYGAME_PROFILE_JOIN2(a, b)
+#define MYGAME_PROFILE_ZONE(name) ProfileZone MYGAME_PROFILE_JOIN(profileZone, __LINE__)(name)
+#else
+#define MYGAME_PROFILE_ZONE(name) ((void)0)
+#endif
+
+//Stores a finished zone in the calling thread's ring buffer. Each thread writes only
+//its own buffer, so recording takes no lock; once full the oldest zones are overwritten.
+void recordProfileZone(const char* name, Uint64 start, Uint64 end);
+
+class ProfileZone {
+
+private:
+    const char* name;
+    Uint64 start;
+
+public:
+
+    explicit ProfileZone(const char* name) : name(name), start(SDL_GetPerformanceCounter()) {}
+    ~ProfileZone() { recordProfileZone(name, start, SDL_GetPerformanceCounter()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+constexpr bool PROFILER_ENABLED =
+#ifdef MYGAME_PROFILE
+        true;
+#else
+        false;
+#endif
+
+//Writes the zones still held by every thread's buffer as Chrome trace event JSON,
+//for chrome://tracing or ui.perfetto.dev. Threads may keep recording meanwhile, zones
+//they overwrite during the dump are left out.
+bool writeChromeTrace(const std::string& path);
+
+#endif //MYGAME_PROFILER_H
@@ -0,0 +1,177 @@
+#include "replay.h"
+#include "track_layout.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+
+uint8_t packInput(const CarInput& input) {
+    return static_cast<uint8_t>((input.accelerate ? 1 : 0) | (input.decelerate ? 2 : 0)
+                              | (input.turnLeft ? 4 : 0) | (input.turnRight ? 8 : 0));
+}
+
+CarInput unpackInput(uint8_t bits) {
+    CarInput input;
+    input.accelerate = (bits & 1) != 0;
+    input.decelerate = (bits & 2) != 0;
+    input.turnLeft = (bits & 4) != 0;
+    input.turnRight = (bits & 8) != 0;
+    return input;
+}
+
+
+InputRecorder::InputRecorder(size_t carCount, double step, int trackScale)
+    : carCount(carCount), step(step), trackScale(trackScale), current((carCount + 1) / 2), packed((carCount + 1) / 2) {}
+
+void InputRecorder::record(const std::vector<CarInput>& inputs) {
+    std::fill(packed.begin(), packed.end(), 0);
+    for (size_t i = 0; i < carCount && i < inputs.size(); i++) {
+        packed[i / 2] |= packInput(inputs[i]) << ((i % 2) * 4);
+    }
+
+    //Controls change every few seconds at most, so consecutive equal ticks share one run
+    if (runLength > 0 && packed != current) flushRun();
+    current = packed;
+    runLength++;
+    tickCount++;
+}
+
+void InputRecorder::flushRun() {
+    if (runLength == 0) return;
+    uint64_t length = runLength;
+    do {
+        uint8_t byte = length & 0x7F;
+        length >>= 7;
+        stream.push_back(length != 0 ? (byte | 0x80) : byte);
+    } while (length != 0);
+    stream.insert(stream.end(), current.begin(), current.end());
+    runLength = 0;
+}
+
+bool InputRecorder::save(const std::string& path) {
+    flushRun();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Unable to write replay " << path << std::endl;
+        return false;
+    }
+    ReplayHeader header = { REPLAY_MAGIC, REPLAY_VERSION, static_cast<uint32_t>(carCount),
+                            static_cast<uint32_t>(trackScale), step, tickCount, RACE_FIXED_POINT ? 1u : 0u, 0 };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(stream.data()), static_cast<std::streamsize>(stream.size()));
+    if (!file) {
+        std::cerr << "Unable to write replay " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool InputReplay::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Unable to open replay " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() < sizeof(header)) {
+        std::cerr << "Replay " << path << " is truncated" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic == REPLAY_MAGIC && header.version < REPLAY_VERSION) {
+        std::cerr << "Replay " << path << " was recorded by an older version with different race rules, record it again"
+                  << std::endl;
+        return false;
+    }
+    if (header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION || header.carCount == 0 || !(header.step > 0.0)
+        || header.trackScale < 1 || header.trackScale > MAX_TRACK_SCALE) {
+        std::cerr << "Replay " << path << " has an unknown format" << std::endl;
+        return false;
+    }
+    if (header.fixedPoint != (RACE_FIXED_POINT ? 1u : 0u)) {
+        std::cerr << "Replay " << path << " was recorded with " << (header.fixedPoint ? "fixed point" : "double")
+                  << " race physics, this build races on " << (RACE_FIXED_POINT ? "fixed point" : "double") << std::endl;
+        return false;
+    }
+    if (header.carCount > maxStartingGridCars(getTrackScale())) {
+        std::cerr << "Replay " << path << " has more cars than the starting grid holds" << std::endl;
+        return false;
+    }
+
+    stream.assign(bytes.begin() + sizeof(header), bytes.end());
+    inputs.resize(header.carCount);
+    rewind();
+    return true;
+}
+
+void InputReplay::rewind() {
+    cursor = 0;
+    runLeft = 0;
+    tick = 0;
+}
+
+bool InputReplay::readRun() {
+    uint64_t length = 0;
+    int shift = 0;
+    while (true) {
+        if (cursor >= stream.size() || shift > 63) return false;
+        uint8_t byte = stream[cursor++];
+        length |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        shift += 7;
+        if ((byte & 0x80) == 0) break;
+    }
+
+    size_t bytes = (header.carCount + 1) / 2;
+    if (length == 0 || stream.size() - cursor < bytes) return false;
+    for (size_t i = 0; i < header.carCount; i++) {
+        inputs[i] = unpackInput((stream[cursor + i / 2] >> ((i % 2) * 4)) & 0x0F);
+    }
+    cursor += bytes;
+    runLeft = length;
+    return true;
+}
+
+bool InputReplay::next(std::vector<CarInput>& tickInputs) {
+    if (tick >= header.tickCount) return false;
+    if (runLeft == 0 && !readRun()) {
+        std::cerr << "Replay ended early at tick " << tick << std::endl;
+        tick = header.tickCount;
+        return false;
+    }
+    runLeft--;
+    tick++;
+    tickInputs = inputs;
+    return true;
+}
+
+
+HeadlessResult runReplay(InputReplay& replay, std::shared_ptr<const TrackMap> track) {
+    HeadlessResult result;
+    auto start = std::chrono::steady_clock::now();
+
+    TrackLayout layout = createTrackLayout(replay.getTrackScale());
+    Simulation simulation(createStartingGrid(replay.getCarCount(), {}, layout.scale), track, PhysicsParameters(),
+                          layout.timingLines);
+    std::vector<CarInput> inputs;
+    replay.rewind();
+    while (!simulation.isRaceFinished() && replay.next(inputs)) {
+        for (size_t i = 0; i < inputs.size(); i++) {
+            simulation.setInput(i, inputs[i]);
+        }
+        simulation.step(replay.getStep());
+        result.collisions += simulation.getCollisionPairs().size();
+    }
+
+    result.racesRun = 1;
+    if (simulation.isRaceFinished()) result.racesFinished = 1;
+    result.ticks = simulation.getTick();
+    result.checksum = simulation.checksum();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
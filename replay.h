@@ -0,0 +1,101 @@
+#ifndef MYGAME_REPLAY_H
+#define MYGAME_REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+
+//Replay file layout, little endian:
+//  ReplayHeader, then runs until tickCount ticks are covered. A run is a LEB128
+//  tick count followed by the controls of every car, one nibble per car
+//  (accelerate, decelerate, left, right from the low bit up), that were held for
+//  that many ticks.
+constexpr uint32_t REPLAY_MAGIC = 0x504C524D; // "MRLP"
+//Version 1 files were recorded before segment lap timing, version 2 before the car pool
+//ran the race physics, both replay a different race. Version 3 did not record the arithmetic.
+constexpr uint32_t REPLAY_VERSION = 4;
+
+struct ReplayHeader {
+    uint32_t magic;
+    uint32_t version;
+    //Cars on the starting grid, see createStartingGrid
+    uint32_t carCount;
+    //TrackLayout scale, 1 to MAX_TRACK_SCALE
+    uint32_t trackScale;
+    //Seconds per tick the race was recorded with
+    double step;
+    uint64_t tickCount;
+    //1 when recorded by a MYGAME_FIXED_POINT build, replays only play back on the same arithmetic
+    uint32_t fixedPoint;
+    uint32_t reserved;
+};
+
+uint8_t packInput(const CarInput& input);
+CarInput unpackInput(uint8_t bits);
+
+//Captures the controls every car had on every tick
+class InputRecorder {
+
+private:
+    size_t carCount;
+    double step;
+    int trackScale;
+    uint64_t tickCount = 0;
+    std::vector<uint8_t> stream;
+    std::vector<uint8_t> current;
+    std::vector<uint8_t> packed;
+    uint64_t runLength = 0;
+
+    void flushRun();
+
+public:
+
+    InputRecorder(size_t carCount, double step, int trackScale = 1);
+
+    //Call once per tick with the inputs the tick is stepped with
+    void record(const std::vector<CarInput>& inputs);
+
+    bool save(const std::string& path);
+
+    uint64_t getTickCount() const { return tickCount; }
+};
+
+//Plays a recorded input stream back one tick at a time
+class InputReplay {
+
+private:
+    ReplayHeader header = {};
+    std::vector<uint8_t> stream;
+    size_t cursor = 0;
+    uint64_t runLeft = 0;
+    uint64_t tick = 0;
+    std::vector<CarInput> inputs;
+
+    bool readRun();
+
+public:
+
+    bool load(const std::string& path);
+
+    //Fills inputs with the controls of the next tick, false once the recording has ended
+    bool next(std::vector<CarInput>& tickInputs);
+
+    //Start over from the first tick
+    void rewind();
+
+    size_t getCarCount() const { return header.carCount; }
+    double getStep() const { return header.step; }
+    uint64_t getTickCount() const { return header.tickCount; }
+    int getTrackScale() const { return static_cast<int>(header.trackScale); }
+};
+
+//Steps one race with the recorded inputs as fast as possible. The checksum of the
+//final state makes a replay usable as a regression baseline. The track map has to be
+//laid out for the replay's track scale.
+HeadlessResult runReplay(InputReplay& replay, std::shared_ptr<const TrackMap> track);
+
+#endif //MYGAME_REPLAY_H
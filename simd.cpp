@@ -0,0 +1,21 @@
+#include "simd.h"
+
+
+SimdLevel detectSimdLevel() {
+#if defined(MYGAME_AVX2)
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+#endif
+#if defined(MYGAME_SSE2)
+    return SimdLevel::SSE2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
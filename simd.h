@@ -0,0 +1,28 @@
+#ifndef MYGAME_SIMD_H
+#define MYGAME_SIMD_H
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MYGAME_SSE2
+#include <emmintrin.h>
+#endif
+
+//AVX2 is compiled per function so the rest of the game keeps the default target
+#if defined(MYGAME_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define MYGAME_AVX2
+#define MYGAME_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+//Best instruction set available on this machine
+SimdLevel detectSimdLevel();
+
+const char* simdLevelName(SimdLevel level);
+
+#endif //MYGAME_SIMD_H
@@ -0,0 +1,281 @@
+#include "simulation.h"
+#include "ai_driver.h"
+#include "profiler.h"
+#include "replay.h"
+#include "state_replay.h"
+#include "track_layout.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+
+std::vector<GridCar> createPlayerCars(SDL_Texture* car1Texture, SDL_Texture* car2Texture, int scale) {
+    //Side by side behind the finish line, which moves with the scale while the cars keep their size
+    return {
+            { 380 * scale - 10, 80 * scale - 20, car1Texture },
+            { 380 * scale - 10, 130 * scale - 20, car2Texture }
+    };
+}
+
+namespace {
+
+//Cars start facing right, so on the grid each one covers CAR_HEIGHT x CAR_WIDTH pixels
+//around the centre of its rect. Slots are that footprint with a gap on every side.
+constexpr int GRID_PITCH_X = 50;
+constexpr int GRID_PITCH_Y = 30;
+constexpr int GRID_MARGIN = 10;
+
+//Top left corners of up to count grid slots in row order, over the whole scaled world.
+//Slots overlapping the player cars are skipped, so no car starts inside another.
+std::vector<SDL_Point> gridSlots(size_t count, int scale, const std::vector<GridCar>& players) {
+    std::vector<SDL_Rect> taken;
+    for (const GridCar& player : players) taken.push_back(boundingRect(player.getBox()));
+
+    std::vector<SDL_Point> slots;
+    for (int y = GRID_MARGIN; y + CAR_WIDTH + GRID_MARGIN <= WINDOW_HEIGHT * scale; y += GRID_PITCH_Y) {
+        for (int x = GRID_MARGIN; x + CAR_HEIGHT + GRID_MARGIN <= WINDOW_WIDTH * scale; x += GRID_PITCH_X) {
+            if (slots.size() >= count) return slots;
+            SDL_Rect footprint = { x, y, CAR_HEIGHT, CAR_WIDTH };
+            bool free = true;
+            for (const SDL_Rect& rect : taken) free = free && !SDL_HasIntersection(&footprint, &rect);
+            //From the footprint back to the top left of the unrotated car rect
+            if (free) slots.push_back({ x + (CAR_HEIGHT - CAR_WIDTH) / 2, y - (CAR_HEIGHT - CAR_WIDTH) / 2 });
+        }
+    }
+    return slots;
+}
+
+}
+
+size_t maxStartingGridCars(int scale) {
+    std::vector<GridCar> players = createPlayerCars(nullptr, nullptr, scale);
+    return players.size() + gridSlots(SIZE_MAX, scale, players).size();
+}
+
+std::vector<GridCar> createStartingGrid(size_t count, const std::vector<SDL_Texture*>& carTextures, int scale) {
+    auto texture = [&carTextures](size_t i) {
+        return carTextures.empty() ? nullptr : carTextures[i % carTextures.size()];
+    };
+
+    std::vector<GridCar> cars = createPlayerCars(texture(0), texture(1), scale);
+    std::vector<SDL_Point> slots = gridSlots(count > cars.size() ? count - cars.size() : 0, scale, cars);
+    for (const SDL_Point& slot : slots) {
+        cars.push_back({ slot.x, slot.y, texture(cars.size()) });
+    }
+    return cars;
+}
+
+Simulation::Simulation(const std::vector<GridCar>& startingCars, std::shared_ptr<const TrackMap> trackMap,
+                       const PhysicsParameters& physicsParameters, std::vector<TimingLine> timingLines)
+    : cars(physicsParameters), track(std::move(trackMap)), physics(physicsParameters), simdLevel(detectSimdLevel()),
+      lapTimer(std::move(timingLines)) {
+    cars.setTrack(track.get());
+    cars.reserve(startingCars.size());
+    for (const GridCar& car : startingCars) {
+        cars.addCar(car.x, car.y);
+        textures.push_back(car.texture);
+    }
+    inputs.resize(cars.size());
+    timings.resize(cars.size());
+}
+
+void Simulation::step(double dt) {
+    MYGAME_PROFILE_ZONE("Simulation::step");
+
+    //Controls are reset every tick and only applied while the race is running
+    cars.savePreviousState();
+    for (size_t i = 0; i < cars.size(); i++) {
+        const CarInput& input = inputs[i];
+        cars.coast(i);
+        if (raceFinished) continue;
+        if (input.accelerate) cars.accelerate(i);
+        if (input.decelerate) cars.decelerate(i);
+        if (input.turnLeft) cars.turn(i, -physics.turnRate * dt);
+        if (input.turnRight) cars.turn(i, physics.turnRate * dt);
+    }
+
+    //Turns and integration of the whole field in the batch kernels, then the walls car by car
+    {
+        MYGAME_PROFILE_ZONE("Car integration");
+        cars.integrate(dt);
+    }
+    {
+        MYGAME_PROFILE_ZONE("Track collisions");
+        cars.collideWithTrack();
+    }
+
+    //Collision checking between cars: the broadphase finds each pair whose bounding
+    //rects overlap once, the rotated boxes of all candidates are tested in one batch,
+    //then every touching pair is resolved a single time
+    {
+        MYGAME_PROFILE_ZONE("Car collisions");
+        carBounds.resize(cars.size());
+        for (size_t i = 0; i < cars.size(); i++) {
+            carBounds[i] = boundingRect(cars.getBox(i));
+        }
+        broadphase.findPairs(carBounds, candidatePairs);
+
+        narrowphase.clear();
+        for (const CollisionPair& pair : candidatePairs) {
+            narrowphase.add(cars.getBox(pair.a), cars.getBox(pair.b));
+        }
+        narrowphase.test(simdLevel);
+
+        collisionPairs.clear();
+        for (size_t i = 0; i < candidatePairs.size(); i++) {
+            if (!narrowphase.isTouching(i)) continue;
+            const CollisionPair& pair = candidatePairs[i];
+            cars.resolveCollision(pair.a, pair.b, narrowphase.getContact(i));
+            collisionPairs.push_back(pair);
+        }
+    }
+
+    //Lap timing after the collisions, so the path of each car includes being pushed
+    if (!raceFinished) {
+        MYGAME_PROFILE_ZONE("Lap timing");
+        for (size_t i = 0; i < cars.size(); i++) {
+            vect_t from = cars.getPreviousCenter(i);
+            vect_t to = cars.getCenter(i);
+            if (!lapTimer.update(timings[i], from.v.x, from.v.y, to.v.x, to.v.y, raceTime, dt)) continue;
+            if (timings[i].lapsCompleted < RACE_LAPS) continue;
+            //Of cars finishing in the same tick the one that crossed the line first wins
+            if (winner < 0 || timings[i].lastCrossing < timings[winner].lastCrossing) {
+                winner = static_cast<int>(i);
+            }
+        }
+        if (winner >= 0) {
+            raceFinished = true;
+            for (size_t i = 0; i < cars.size(); i++) cars.stop(i);
+        }
+    }
+
+    raceTime += dt;
+    tick++;
+}
+
+void Simulation::saveState(SimulationState& state) const {
+    state.cars = cars;
+    state.inputs.assign(inputs.begin(), inputs.end());
+    state.broadphaseOrder.assign(broadphase.getOrder().begin(), broadphase.getOrder().end());
+    state.timings.assign(timings.begin(), timings.end());
+    state.raceTime = raceTime;
+    state.tick = tick;
+    state.winner = winner;
+    state.raceFinished = raceFinished;
+}
+
+void Simulation::restoreState(const SimulationState& state) {
+    cars = state.cars;
+    inputs.assign(state.inputs.begin(), state.inputs.end());
+    broadphase.setOrder(state.broadphaseOrder);
+    timings.assign(state.timings.begin(), state.timings.end());
+    raceTime = state.raceTime;
+    tick = state.tick;
+    winner = state.winner;
+    raceFinished = state.raceFinished;
+}
+
+uint64_t Simulation::checksum() const {
+    //FNV-1a over the raw bits, any difference in rounding shows up
+    uint64_t hash = cars.checksum();
+    auto mix = [&hash](const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    mix(&tick, sizeof(tick));
+    mix(&winner, sizeof(winner));
+    return hash;
+}
+
+
+ScriptedDriver::ScriptedDriver(uint32_t seed, double dt)
+    : state(seed), period(std::max<uint64_t>(1, static_cast<uint64_t>(0.5 / dt + 0.5))) {}
+
+uint32_t ScriptedDriver::next() {
+    state = state * 1664525u + 1013904223u;
+    return state >> 16;
+}
+
+CarInput ScriptedDriver::drive(uint64_t tick) {
+    if (tick % period == 0) {
+        uint32_t r = next();
+        input.accelerate = (r % 8) != 0;
+        input.decelerate = !input.accelerate;
+        input.turnLeft = (r / 8) % 3 == 0;
+        input.turnRight = (r / 8) % 3 == 1;
+    }
+    return input;
+}
+
+RaceResult runRace(const HeadlessOptions& options, std::shared_ptr<const TrackMap> track, uint32_t seed,
+                   const PhysicsParameters& physics, WorkerPool* pool, InputRecorder* recorder,
+                   StateReplayWriter* stateWriter) {
+    RaceResult result;
+    TrackLayout layout = createTrackLayout(options.trackScale);
+    Simulation simulation(createStartingGrid(options.cars, {}, layout.scale), std::move(track), physics,
+                          layout.timingLines);
+    AiDrivers aiDrivers(layout.waypoints, 0, pool);
+    std::vector<ScriptedDriver> drivers;
+    for (size_t i = 0; !options.aiDrivers && i < simulation.getCars().size(); i++) {
+        drivers.emplace_back(seed + static_cast<uint32_t>(i) * 104729u, options.dt);
+    }
+
+    if (stateWriter) stateWriter->record(simulation);
+    while (!simulation.isRaceFinished() && simulation.getTick() < options.maxTicks) {
+        for (size_t i = 0; i < drivers.size(); i++) {
+            simulation.setInput(i, drivers[i].drive(simulation.getTick()));
+        }
+        if (options.aiDrivers) aiDrivers.drive(simulation);
+        if (recorder) recorder->record(simulation.getInputs());
+        simulation.step(options.dt);
+        if (stateWriter) stateWriter->record(simulation);
+        result.collisions += simulation.getCollisionPairs().size();
+    }
+
+    result.finished = simulation.isRaceFinished();
+    result.winner = simulation.getWinner();
+    result.ticks = simulation.getTick();
+    result.checksum = simulation.checksum();
+
+    size_t lines = simulation.getTimingLineCount();
+    result.order.resize(simulation.getCars().size());
+    for (uint32_t i = 0; i < result.order.size(); i++) {
+        result.order[i] = i;
+        double bestLap = simulation.getTiming(i).bestLap;
+        if (bestLap > 0.0 && (result.bestLap == 0.0 || bestLap < result.bestLap)) result.bestLap = bestLap;
+    }
+    std::stable_sort(result.order.begin(), result.order.end(), [&](uint32_t a, uint32_t b) {
+        return isAhead(simulation.getTiming(a), simulation.getTiming(b), lines);
+    });
+    if (result.finished) result.finishTime = simulation.getTiming(result.winner).lastCrossing;
+    return result;
+}
+
+HeadlessResult runHeadless(const HeadlessOptions& options, std::shared_ptr<const TrackMap> track,
+                           InputRecorder* recorder, StateReplayWriter* stateWriter) {
+    HeadlessResult result;
+    auto start = std::chrono::steady_clock::now();
+
+    std::unique_ptr<WorkerPool> pool;
+    if (options.aiDrivers) pool = std::make_unique<WorkerPool>(options.threads);
+
+    for (int race = 0; race < options.races; race++) {
+        RaceResult raceResult = runRace(options, track, options.seed + race * 7919u, PhysicsParameters(),
+                                        pool.get(), race == 0 ? recorder : nullptr,
+                                        race == 0 ? stateWriter : nullptr);
+        result.racesRun++;
+        if (raceResult.finished) result.racesFinished++;
+        result.ticks += raceResult.ticks;
+        result.collisions += raceResult.collisions;
+        if (raceResult.bestLap > 0.0 && (result.bestLap == 0.0 || raceResult.bestLap < result.bestLap)) {
+            result.bestLap = raceResult.bestLap;
+        }
+        result.checksum = result.checksum * 31 + raceResult.checksum;
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
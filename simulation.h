@@ -0,0 +1,205 @@
+#ifndef MYGAME_SIMULATION_H
+#define MYGAME_SIMULATION_H
+
+#include "broadphase.h"
+#include "car.h"
+#include "car_pool.h"
+#include "lap_timing.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+//Control state of one car for a single tick
+struct CarInput {
+    bool accelerate = false;
+    bool decelerate = false;
+    bool turnLeft = false;
+    bool turnRight = false;
+};
+
+//The two player cars on the starting grid (textures may be null), scale as in TrackLayout
+std::vector<GridCar> createPlayerCars(SDL_Texture* car1Texture, SDL_Texture* car2Texture, int scale = 1);
+
+//The player cars followed by count - 2 extra cars in rows across the scaled world, textures
+//are used in turn. The grid never overlaps itself, so it holds at most maxStartingGridCars
+//cars and larger counts are cut down to that.
+std::vector<GridCar> createStartingGrid(size_t count, const std::vector<SDL_Texture*>& carTextures, int scale = 1);
+
+size_t maxStartingGridCars(int scale = 1);
+
+//Full state of a Simulation between two ticks. The vectors keep their capacity, so
+//saving into the same SimulationState again does not allocate.
+struct SimulationState {
+    CarPool cars;
+    std::vector<CarInput> inputs;
+    std::vector<uint32_t> broadphaseOrder;
+    std::vector<CarTiming> timings;
+    double raceTime = 0.0;
+    uint64_t tick = 0;
+    int winner = -1;
+    bool raceFinished = false;
+};
+
+//Race state stepped independently of any window or renderer
+class Simulation {
+
+private:
+    CarPool cars;
+    //Sprite of each car, may be null
+    std::vector<SDL_Texture*> textures;
+    std::vector<CarInput> inputs;
+    std::shared_ptr<const TrackMap> track;
+    PhysicsParameters physics;
+    SweepAndPrune broadphase;
+    std::vector<SDL_Rect> carBounds;
+    std::vector<CollisionPair> candidatePairs;
+    BoxPairBatch narrowphase;
+    SimdLevel simdLevel;
+    std::vector<CollisionPair> collisionPairs;
+    LapTimer lapTimer;
+    std::vector<CarTiming> timings;
+    //Sum of every dt stepped so far, lap times are measured in it
+    double raceTime = 0.0;
+    bool raceFinished = false;
+    int winner = -1;
+    uint64_t tick = 0;
+
+public:
+
+    //Without a track map only the window edges stop the cars
+    explicit Simulation(const std::vector<GridCar>& startingCars, std::shared_ptr<const TrackMap> trackMap = nullptr,
+                        const PhysicsParameters& physicsParameters = PhysicsParameters(),
+                        std::vector<TimingLine> timingLines = TRACK_TIMING_LINES);
+
+    void setInput(size_t car, const CarInput& input) {
+        inputs[car] = input;
+    }
+
+    //Advance the race by one tick: controls, the batch integration of every car, walls,
+    //collisions between cars and lap timing. The first car to complete RACE_LAPS laps wins.
+    void step(double dt);
+
+    const CarPool& getCars() const { return cars; }
+
+    //What the renderer needs to draw a car
+    CarSnapshot snapshot(size_t car) const { return cars.snapshot(car, textures[car]); }
+
+    bool isRaceFinished() const { return raceFinished; }
+
+    //Index of the winning car, -1 while the race is running
+    int getWinner() const { return winner; }
+
+    uint64_t getTick() const { return tick; }
+
+    double getRaceTime() const { return raceTime; }
+
+    //Laps and sector splits of a car
+    const CarTiming& getTiming(size_t car) const { return timings[car]; }
+    size_t getTimingLineCount() const { return lapTimer.getLineCount(); }
+
+    //Controls the next step() is going to apply
+    const std::vector<CarInput>& getInputs() const { return inputs; }
+
+    const PhysicsParameters& getPhysics() const { return physics; }
+
+    //Instruction set of the car integration and the narrowphase, the best the machine has
+    //by default. Every level steps the same race bit for bit.
+    void setSimdLevel(SimdLevel level) {
+        simdLevel = level;
+        cars.setSimdLevel(level);
+    }
+
+    //Copies the state out and back in, restoring and stepping again repeats the same ticks
+    //bit for bit. Only valid for a simulation with the same cars, track and physics.
+    void saveState(SimulationState& state) const;
+    void restoreState(const SimulationState& state);
+
+    //Hash of every car's position, velocity and heading, equal only for bit identical races
+    uint64_t checksum() const;
+
+    //Pairs that touched during the last tick
+    const std::vector<CollisionPair>& getCollisionPairs() const { return collisionPairs; }
+};
+
+
+//Deterministic stand-in for the keyboard: full throttle with steering that
+//changes every half second of simulated time
+class ScriptedDriver {
+
+private:
+    uint32_t state;
+    uint64_t period;
+    CarInput input;
+
+    uint32_t next();
+
+public:
+
+    ScriptedDriver(uint32_t seed, double dt);
+
+    //Call once per tick in tick order, the steering is drawn on the first tick of each period
+    CarInput drive(uint64_t tick);
+};
+
+
+struct HeadlessOptions {
+    int races = 1;
+    size_t cars = 2;
+    uint64_t maxTicks = 100000;
+    double dt = 1. / 120.;
+    uint32_t seed = 1;
+    //Waypoint-following AI instead of the scripted random drivers
+    bool aiDrivers = false;
+    //Threads for the AI decision pass, 0 uses every core
+    size_t threads = 0;
+    //World size in windows, see TrackLayout. The track map passed along has to match it.
+    int trackScale = 1;
+};
+
+struct HeadlessResult {
+    int racesRun = 0;
+    int racesFinished = 0;
+    uint64_t ticks = 0;
+    uint64_t collisions = 0;
+    double seconds = 0.0;
+    //Fastest lap of any car in any race, 0 when no lap was completed
+    double bestLap = 0.0;
+    //Simulation::checksum of the final state of every race, combined
+    uint64_t checksum = 0;
+
+    double ticksPerSecond() const { return seconds > 0.0 ? ticks / seconds : 0.0; }
+};
+
+class InputRecorder;
+class StateReplayWriter;
+class WorkerPool;
+
+struct RaceResult {
+    bool finished = false;
+    int winner = -1;
+    uint64_t ticks = 0;
+    uint64_t collisions = 0;
+    uint64_t checksum = 0;
+    //Race time the winner crossed the finish line, within the tick
+    double finishTime = 0.0;
+    //Fastest lap of any car, 0 when no lap was completed
+    double bestLap = 0.0;
+    //Car indices by race position, the winner leads a finished race
+    std::vector<uint32_t> order;
+};
+
+//One race with the drivers chosen by options, seeded by seed, until it is won or
+//maxTicks pass. The pool is only used by AI drivers and may be null.
+RaceResult runRace(const HeadlessOptions& options, std::shared_ptr<const TrackMap> track, uint32_t seed,
+                   const PhysicsParameters& physics, WorkerPool* pool = nullptr, InputRecorder* recorder = nullptr,
+                   StateReplayWriter* stateWriter = nullptr);
+
+//Runs races back to back as fast as possible with scripted or AI drivers, no window needed.
+//Each race stops when it is won or after maxTicks. The inputs and states of the first
+//race go to the recorder and state writer when they are given.
+HeadlessResult runHeadless(const HeadlessOptions& options, std::shared_ptr<const TrackMap> track,
+                           InputRecorder* recorder = nullptr, StateReplayWriter* stateWriter = nullptr);
+
+#endif //MYGAME_SIMULATION_H
@@ -0,0 +1,78 @@
+#include "simulation_thread.h"
+#include "fixed_timestep.h"
+#include "profiler.h"
+
+
+SimulationThread::SimulationThread(Simulation& simulation, double rate, InputReplay* replay,
+                                   InputRecorder* recorder, AiDrivers* aiDrivers, StateReplayWriter* stateWriter)
+    : simulation(simulation), step(1.0 / rate), replay(replay), recorder(recorder), aiDrivers(aiDrivers),
+      stateWriter(stateWriter) {
+    //The render thread has the starting grid to draw before the first tick
+    publish(std::chrono::steady_clock::now());
+}
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+void SimulationThread::start() {
+    stopping.store(false);
+    thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    stopping.store(true);
+    if (thread.joinable()) thread.join();
+}
+
+void SimulationThread::publish(std::chrono::steady_clock::time_point time) {
+    RaceSnapshot& snapshot = snapshots.writeBuffer();
+    snapshot.cars.resize(simulation.getCars().size());
+    for (size_t i = 0; i < snapshot.cars.size(); i++) {
+        snapshot.cars[i] = simulation.snapshot(i);
+    }
+    snapshot.tick = simulation.getTick();
+    snapshot.raceFinished = simulation.isRaceFinished();
+    snapshot.winner = simulation.getWinner();
+    snapshot.inputsApplied = inputsApplied;
+    snapshot.time = time;
+    snapshots.publish();
+    if (stateWriter) stateWriter->record(simulation);
+}
+
+void SimulationThread::run() {
+    using clock = std::chrono::steady_clock;
+    FixedTimestep timestep(1.0 / step);
+    clock::time_point last = clock::now();
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        clock::time_point now = clock::now();
+        int ticks = timestep.advance(std::chrono::duration<double>(now - last).count());
+        last = now;
+
+        for (int i = ticks - 1; i >= 0; i--) {
+            MYGAME_PROFILE_ZONE("Simulation tick");
+            InputMessage message;
+            while (inputs.pop(message)) {
+                if (message.car < simulation.getCars().size()) simulation.setInput(message.car, message.input);
+                inputsApplied++;
+            }
+            if (aiDrivers) aiDrivers->drive(simulation);
+            if (replay) {
+                //Cars coast once the recording has ended
+                if (!replay->next(replayInputs)) replayInputs.assign(simulation.getCars().size(), CarInput());
+                for (size_t car = 0; car < replayInputs.size(); car++) simulation.setInput(car, replayInputs[car]);
+            }
+            if (recorder) recorder->record(simulation.getInputs());
+
+            simulation.step(step);
+            //When this tick was due, i ticks before the last one of this batch
+            double late = (timestep.alpha() + i) * step;
+            publish(now - std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(late)));
+        }
+
+        //Sleep until the next tick is due
+        double wait = (1.0 - timestep.alpha()) * step;
+        std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef MYGAME_SIMULATION_THREAD_H
+#define MYGAME_SIMULATION_THREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "ai_driver.h"
+#include "replay.h"
+#include "simulation.h"
+#include "spsc_queue.h"
+#include "state_replay.h"
+#include "triple_buffer.h"
+
+
+//Race state as of one tick, everything the render thread reads from the simulation
+struct RaceSnapshot {
+    std::vector<CarSnapshot> cars;
+    uint64_t tick = 0;
+    bool raceFinished = false;
+    int winner = -1;
+    //Input messages applied up to and including this tick, in the order they were sent
+    uint64_t inputsApplied = 0;
+    //When the tick was due, the renderer interpolates from here towards the next one
+    std::chrono::steady_clock::time_point time;
+};
+
+//New controls for one car, sent by the render thread when a key changes
+struct InputMessage {
+    uint32_t car;
+    CarInput input;
+};
+
+//Steps a Simulation at a fixed rate on its own thread. Inputs arrive through an SPSC
+//queue and every tick is published through a triple buffer, so the render thread never
+//waits on physics and vsync never delays a tick.
+class SimulationThread {
+
+private:
+    Simulation& simulation;
+    double step;
+    InputReplay* replay;
+    InputRecorder* recorder;
+    AiDrivers* aiDrivers;
+    StateReplayWriter* stateWriter;
+    std::vector<CarInput> replayInputs;
+    uint64_t inputsApplied = 0;
+
+    SpscQueue<InputMessage, 256> inputs;
+    TripleBuffer<RaceSnapshot> snapshots;
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+
+    void run();
+    void publish(std::chrono::steady_clock::time_point time);
+
+public:
+
+    //The simulation must not be touched by anyone else until stop() returns.
+    //AI drivers set their cars' inputs before every tick, a replay replaces all inputs
+    //and a recorder sees every tick. The state writer gets every published tick.
+    SimulationThread(Simulation& simulation, double rate, InputReplay* replay = nullptr,
+                     InputRecorder* recorder = nullptr, AiDrivers* aiDrivers = nullptr,
+                     StateReplayWriter* stateWriter = nullptr);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    void start();
+    void stop();
+
+    //Render thread: queues new controls, false if the queue is full and it has to be retried
+    bool sendInput(uint32_t car, const CarInput& input) { return inputs.push({ car, input }); }
+
+    //Render thread: the newest published tick, the same one until another is published
+    const RaceSnapshot& latest() {
+        snapshots.update();
+        return snapshots.readBuffer();
+    }
+
+    double getStep() const { return step; }
+};
+
+#endif //MYGAME_SIMULATION_THREAD_H
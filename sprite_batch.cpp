@@ -0,0 +1,250 @@
+#include "sprite_batch.h"
+#include "profiler.h"
+#include "trig.h"
+
+#include <algorithm>
+#include <iostream>
+
+
+namespace {
+
+//Empty pixels between atlas entries so filtering never picks up the neighbouring car
+constexpr int ATLAS_PADDING = 1;
+
+//Inputs and outputs of the corner pass, positions get x and y of four corners per quad
+struct CornerArgs {
+    const float* centerX;
+    const float* centerY;
+    const float* halfWidth;
+    const float* halfHeight;
+    const double* sines;
+    const double* cosines;
+    float* positions;
+};
+
+//Corners in texture order: top left, top right, bottom right, bottom left. The quad is
+//rotated clockwise on screen like SDL_RenderCopyEx does, x' = cx + c*dx - s*dy, y' = cy + s*dx + c*dy
+void cornersScalar(const CornerArgs& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        float s = static_cast<float>(a.sines[i]);
+        float c = static_cast<float>(a.cosines[i]);
+        //Half extents along the car's length and across it
+        float ax = c * a.halfWidth[i];
+        float ay = s * a.halfWidth[i];
+        float bx = -s * a.halfHeight[i];
+        float by = c * a.halfHeight[i];
+        float* out = a.positions + i * 8;
+        out[0] = a.centerX[i] - ax - bx;
+        out[1] = a.centerY[i] - ay - by;
+        out[2] = a.centerX[i] + ax - bx;
+        out[3] = a.centerY[i] + ay - by;
+        out[4] = a.centerX[i] + ax + bx;
+        out[5] = a.centerY[i] + ay + by;
+        out[6] = a.centerX[i] - ax + bx;
+        out[7] = a.centerY[i] - ay + by;
+    }
+}
+
+#if defined(MYGAME_SSE2)
+//Four quads per iteration, the corners are transposed back into x,y pairs per vertex
+size_t cornersSSE2(const CornerArgs& a, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 s = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(a.sines + i)), _mm_cvtpd_ps(_mm_loadu_pd(a.sines + i + 2)));
+        __m128 c = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(a.cosines + i)),
+                                 _mm_cvtpd_ps(_mm_loadu_pd(a.cosines + i + 2)));
+        __m128 cx = _mm_loadu_ps(a.centerX + i);
+        __m128 cy = _mm_loadu_ps(a.centerY + i);
+        __m128 hw = _mm_loadu_ps(a.halfWidth + i);
+        __m128 hh = _mm_loadu_ps(a.halfHeight + i);
+
+        __m128 ax = _mm_mul_ps(c, hw);
+        __m128 ay = _mm_mul_ps(s, hw);
+        __m128 bx = _mm_mul_ps(_mm_xor_ps(s, _mm_set1_ps(-0.0f)), hh);
+        __m128 by = _mm_mul_ps(c, hh);
+
+        __m128 corners[8] = {
+                _mm_sub_ps(_mm_sub_ps(cx, ax), bx), _mm_sub_ps(_mm_sub_ps(cy, ay), by),
+                _mm_sub_ps(_mm_add_ps(cx, ax), bx), _mm_sub_ps(_mm_add_ps(cy, ay), by),
+                _mm_add_ps(_mm_add_ps(cx, ax), bx), _mm_add_ps(_mm_add_ps(cy, ay), by),
+                _mm_add_ps(_mm_sub_ps(cx, ax), bx), _mm_add_ps(_mm_sub_ps(cy, ay), by)
+        };
+
+        //Each corner pair interleaved to x0 y0 x1 y1 and x2 y2 x3 y3, then two corners per store
+        float* out = a.positions + i * 8;
+        for (int corner = 0; corner < 4; corner += 2) {
+            __m128 firstLow = _mm_unpacklo_ps(corners[corner * 2], corners[corner * 2 + 1]);
+            __m128 firstHigh = _mm_unpackhi_ps(corners[corner * 2], corners[corner * 2 + 1]);
+            __m128 secondLow = _mm_unpacklo_ps(corners[corner * 2 + 2], corners[corner * 2 + 3]);
+            __m128 secondHigh = _mm_unpackhi_ps(corners[corner * 2 + 2], corners[corner * 2 + 3]);
+            _mm_storeu_ps(out + corner * 2, _mm_movelh_ps(firstLow, secondLow));
+            _mm_storeu_ps(out + 8 + corner * 2, _mm_movehl_ps(secondLow, firstLow));
+            _mm_storeu_ps(out + 16 + corner * 2, _mm_movelh_ps(firstHigh, secondHigh));
+            _mm_storeu_ps(out + 24 + corner * 2, _mm_movehl_ps(secondHigh, firstHigh));
+        }
+    }
+    return i;
+}
+#endif
+
+}
+
+
+SpriteBatch::SpriteBatch(SDL_Renderer* renderer, const std::vector<SDL_Texture*>& textures)
+    : renderer(renderer), level(detectSimdLevel()) {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0) useGeometry = (info.flags & SDL_RENDERER_SOFTWARE) == 0;
+
+    //One row, each texture at its own size
+    for (SDL_Texture* texture : textures) {
+        if (texture == nullptr || findSprite(texture) >= 0) continue;
+        int width = 0;
+        int height = 0;
+        SDL_QueryTexture(texture, nullptr, nullptr, &width, &height);
+        sprites.push_back({ texture, { atlasWidth, 0, width, height }, 0.0f, 0.0f, 0.0f, 0.0f });
+        atlasWidth += width + ATLAS_PADDING;
+        atlasHeight = std::max(atlasHeight, height);
+    }
+    for (Sprite& sprite : sprites) {
+        sprite.u0 = static_cast<float>(sprite.area.x) / atlasWidth;
+        sprite.v0 = 0.0f;
+        sprite.u1 = static_cast<float>(sprite.area.x + sprite.area.w) / atlasWidth;
+        sprite.v1 = static_cast<float>(sprite.area.h) / atlasHeight;
+    }
+    rebuild();
+}
+
+SpriteBatch::~SpriteBatch() {
+    if (atlas) SDL_DestroyTexture(atlas);
+}
+
+void SpriteBatch::rebuild() {
+    if (sprites.empty()) return;
+    if (atlas == nullptr) {
+        atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, atlasWidth, atlasHeight);
+        if (atlas == nullptr) {
+            std::cerr << "Unable to create sprite atlas! SDL Error: " << SDL_GetError() << std::endl;
+            return;
+        }
+    }
+
+    //Drawn with the textures' own blending onto transparent black, so colour keyed pixels keep alpha 0
+    SDL_Texture* previous = SDL_GetRenderTarget(renderer);
+    if (SDL_SetRenderTarget(renderer, atlas) != 0) {
+        std::cerr << "Unable to draw into sprite atlas! SDL Error: " << SDL_GetError() << std::endl;
+        SDL_DestroyTexture(atlas);
+        atlas = nullptr;
+        return;
+    }
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    for (const Sprite& sprite : sprites) {
+        SDL_RenderCopy(renderer, sprite.source, nullptr, &sprite.area);
+    }
+    SDL_SetRenderTarget(renderer, previous);
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+}
+
+int SpriteBatch::findSprite(SDL_Texture* texture) const {
+    for (size_t i = 0; i < sprites.size(); i++) {
+        if (sprites[i].source == texture) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool SpriteBatch::add(const CarSnapshot& car, double alpha, const SDL_Rect& view, Uint8 alphaMod) {
+    int sprite = findSprite(car.texture);
+    if (sprite < 0) return false;
+
+    vect_t drawPosition = car.previousPosition + (car.position - car.previousPosition) * alpha;
+    float x = static_cast<float>(drawPosition.v.x - view.x + car.width / 2.0);
+    float y = static_cast<float>(drawPosition.v.y - view.y + car.height / 2.0);
+
+    //Rotated about its centre the sprite stays within a square as wide as its diagonal
+    float reach = (car.width + car.height) / 2.0f;
+    if (x + reach < 0 || y + reach < 0 || x - reach > view.w || y - reach > view.h) return false;
+
+    centerX.push_back(x);
+    centerY.push_back(y);
+    halfWidth.push_back(car.width / 2.0f);
+    halfHeight.push_back(car.height / 2.0f);
+    angles.push_back(car.previousAngle + (car.angle - car.previousAngle) * alpha);
+    spriteIndex.push_back(sprite);
+    opacity.push_back(alphaMod);
+    return true;
+}
+
+void SpriteBatch::buildCorners(size_t count) {
+    sines.resize(count);
+    cosines.resize(count);
+    positions.resize(count * 8);
+    sinCosDegreesBatch(angles.data(), sines.data(), cosines.data(), count, level);
+
+    CornerArgs args = { centerX.data(), centerY.data(), halfWidth.data(), halfHeight.data(),
+                        sines.data(), cosines.data(), positions.data() };
+    size_t done = 0;
+#if defined(MYGAME_SSE2)
+    if (level != SimdLevel::Scalar) done = cornersSSE2(args, count);
+#endif
+    //Quads left over after the last full vector
+    cornersScalar(args, done, count);
+}
+
+void SpriteBatch::drawGeometry(size_t count) {
+    buildCorners(count);
+
+    texCoords.resize(count * 8);
+    colors.resize(count * 4);
+    for (size_t i = 0; i < count; i++) {
+        const Sprite& sprite = sprites[spriteIndex[i]];
+        float* uv = texCoords.data() + i * 8;
+        uv[0] = sprite.u0; uv[1] = sprite.v0;
+        uv[2] = sprite.u1; uv[3] = sprite.v0;
+        uv[4] = sprite.u1; uv[5] = sprite.v1;
+        uv[6] = sprite.u0; uv[7] = sprite.v1;
+        SDL_Color color = { 255, 255, 255, opacity[i] };
+        std::fill_n(colors.data() + i * 4, 4, color);
+    }
+
+    //Two triangles per quad, the pattern only changes when the batch grows
+    for (size_t i = indices.size() / 6; i < count; i++) {
+        int first = static_cast<int>(i * 4);
+        const int corners[6] = { 0, 1, 2, 0, 2, 3 };
+        for (int corner : corners) indices.push_back(first + corner);
+    }
+
+    SDL_RenderGeometryRaw(renderer, atlas, positions.data(), 2 * sizeof(float), colors.data(), sizeof(SDL_Color),
+                          texCoords.data(), 2 * sizeof(float), static_cast<int>(count * 4), indices.data(),
+                          static_cast<int>(count * 6), sizeof(int));
+}
+
+void SpriteBatch::drawCopies(size_t count) {
+    Uint8 current = 255;
+    for (size_t i = 0; i < count; i++) {
+        if (opacity[i] != current) {
+            current = opacity[i];
+            SDL_SetTextureAlphaMod(atlas, current);
+        }
+        SDL_FRect rect = { centerX[i] - halfWidth[i], centerY[i] - halfHeight[i], halfWidth[i] * 2, halfHeight[i] * 2 };
+        SDL_RenderCopyExF(renderer, atlas, &sprites[spriteIndex[i]].area, &rect, angles[i], nullptr, SDL_FLIP_NONE);
+    }
+    if (current != 255) SDL_SetTextureAlphaMod(atlas, 255);
+}
+
+int SpriteBatch::flush() {
+    size_t count = spriteIndex.size();
+    if (count == 0) return 0;
+    MYGAME_PROFILE_ZONE("Sprite batch");
+
+    if (useGeometry) drawGeometry(count);
+    else drawCopies(count);
+
+    centerX.clear();
+    centerY.clear();
+    halfWidth.clear();
+    halfHeight.clear();
+    angles.clear();
+    spriteIndex.clear();
+    opacity.clear();
+    return useGeometry ? 1 : static_cast<int>(count);
+}
@@ -0,0 +1,82 @@
+#ifndef MYGAME_SPRITE_BATCH_H
+#define MYGAME_SPRITE_BATCH_H
+
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <vector>
+
+#include "car.h"
+#include "simd.h"
+
+
+//Draws every car of a frame with one SDL_RenderGeometry call. The car textures are
+//copied into a single atlas when the batch is created; each frame the queued cars are
+//turned into rotated quads four at a time with SSE2 and submitted together, so the cost
+//on the render queue does not grow with the number of cars. The software renderer fills
+//triangles several times slower than it rotates and blits, there every car is copied out
+//of the atlas on its own instead.
+class SpriteBatch {
+
+private:
+    struct Sprite {
+        SDL_Texture* source;
+        SDL_Rect area;
+        float u0, v0, u1, v1;
+    };
+
+    SDL_Renderer* renderer;
+    SDL_Texture* atlas = nullptr;
+    int atlasWidth = 0;
+    int atlasHeight = 0;
+    std::vector<Sprite> sprites;
+    SimdLevel level;
+    bool useGeometry = true;
+
+    //Queued quads, one entry per car in draw order
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> halfWidth;
+    std::vector<float> halfHeight;
+    std::vector<double> angles;
+    std::vector<int> spriteIndex;
+    std::vector<Uint8> opacity;
+
+    //Vertex streams for SDL_RenderGeometryRaw, reused between frames
+    std::vector<double> sines;
+    std::vector<double> cosines;
+    std::vector<float> positions;
+    std::vector<float> texCoords;
+    std::vector<SDL_Color> colors;
+    std::vector<int> indices;
+
+    int findSprite(SDL_Texture* texture) const;
+    void buildCorners(size_t count);
+    void drawGeometry(size_t count);
+    void drawCopies(size_t count);
+
+public:
+
+    //Every texture a car may use, each is copied into the atlas once
+    SpriteBatch(SDL_Renderer* renderer, const std::vector<SDL_Texture*>& textures);
+    ~SpriteBatch();
+
+    SpriteBatch(const SpriteBatch&) = delete;
+    SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+    //False when the renderer cannot draw into textures, cars then need drawCar
+    bool isReady() const { return atlas != nullptr; }
+
+    //Copies the textures again, the atlas is lost when the renderer resets its targets
+    void rebuild();
+
+    //Queues the car interpolated by alpha, false if it is outside the view or its texture
+    //is not in the atlas. alphaMod fades the whole sprite (ghosts).
+    bool add(const CarSnapshot& car, double alpha, const SDL_Rect& view, Uint8 alphaMod = 255);
+
+    //Draws everything queued since the last flush, returns the number of render calls
+    int flush();
+
+    size_t getQueued() const { return spriteIndex.size(); }
+};
+
+#endif //MYGAME_SPRITE_BATCH_H
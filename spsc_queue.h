@@ -0,0 +1,42 @@
+#ifndef MYGAME_SPSC_QUEUE_H
+#define MYGAME_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+
+//Bounded lock-free queue for exactly one producer thread and one consumer thread.
+//Capacity must be a power of two. The two indices sit on separate cache lines so the
+//threads do not keep stealing the line from each other.
+template <typename T, size_t Capacity>
+class SpscQueue {
+
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+private:
+    T items[Capacity];
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+
+public:
+
+    //Producer thread: false when the queue is full
+    bool push(const T& item) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - head.load(std::memory_order_acquire) == Capacity) return false;
+        items[position & (Capacity - 1)] = item;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    //Consumer thread: false when the queue is empty
+    bool pop(T& item) {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire)) return false;
+        item = items[position & (Capacity - 1)];
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif //MYGAME_SPSC_QUEUE_H
@@ -0,0 +1,234 @@
+#include "state_replay.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+
+namespace {
+
+int64_t quantize(double value) {
+    return static_cast<int64_t>(std::llround(value * STATE_REPLAY_SCALE));
+}
+
+double dequantize(int64_t value) {
+    return static_cast<double>(value) / STATE_REPLAY_SCALE;
+}
+
+void appendVarint(std::vector<uint8_t>& out, int64_t value) {
+    //Zigzag keeps small negative numbers small
+    uint64_t bits = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    do {
+        uint8_t byte = bits & 0x7F;
+        bits >>= 7;
+        out.push_back(bits != 0 ? (byte | 0x80) : byte);
+    } while (bits != 0);
+}
+
+bool readVarint(const uint8_t*& cursor, const uint8_t* end, int64_t& value) {
+    uint64_t bits = 0;
+    int shift = 0;
+    while (true) {
+        if (cursor >= end || shift > 63) return false;
+        uint8_t byte = *cursor++;
+        bits |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        shift += 7;
+        if ((byte & 0x80) == 0) break;
+    }
+    value = static_cast<int64_t>(bits >> 1) ^ -static_cast<int64_t>(bits & 1);
+    return true;
+}
+
+//Where a value is heading if it keeps changing by the same amount as last tick
+int64_t predict(int64_t previous, int64_t beforePrevious) {
+    return static_cast<int64_t>(2 * static_cast<uint64_t>(previous) - static_cast<uint64_t>(beforePrevious));
+}
+
+}
+
+
+StateReplayWriter::~StateReplayWriter() {
+    close();
+}
+
+bool StateReplayWriter::open(const std::string& path, size_t carCount, double step, uint32_t keyframeInterval) {
+    close();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Unable to write state replay " << path << std::endl;
+        return false;
+    }
+
+    header = { STATE_REPLAY_MAGIC, STATE_REPLAY_VERSION, static_cast<uint32_t>(carCount),
+               keyframeInterval > 0 ? keyframeInterval : 1, step, 0, 0 };
+    //Written again with the tick count and index offset on close
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    offset = sizeof(header);
+    index.clear();
+    failed.store(false);
+    stopping.store(false);
+    thread = std::thread(&StateReplayWriter::run, this);
+    return true;
+}
+
+void StateReplayWriter::record(const Simulation& simulation) {
+    staging.values.resize(1 + header.carCount * 3);
+    staging.values[0] = simulation.getWinner();
+    for (size_t i = 0; i < header.carCount; i++) {
+        CarSnapshot car = i < simulation.getCars().size() ? simulation.snapshot(i) : CarSnapshot{};
+        staging.values[1 + i * 3] = quantize(car.position.v.x);
+        staging.values[2 + i * 3] = quantize(car.position.v.y);
+        staging.values[3 + i * 3] = quantize(car.angle);
+    }
+    while (!queue.push(staging)) std::this_thread::yield();
+}
+
+void StateReplayWriter::run() {
+    while (true) {
+        bool stop = stopping.load(std::memory_order_acquire);
+        while (queue.pop(frame)) encode(frame);
+        if (stop) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void StateReplayWriter::encode(const QueuedFrame& queued) {
+    const std::vector<int64_t>& values = queued.values;
+    encoded.clear();
+    if (header.tickCount % header.keyframeInterval == 0) {
+        index.push_back(offset);
+        encoded.resize(values.size() * sizeof(int64_t));
+        std::memcpy(encoded.data(), values.data(), encoded.size());
+        //The first frame after a keyframe predicts no motion
+        beforePrevious = values;
+    } else {
+        for (size_t i = 0; i < values.size(); i++) {
+            appendVarint(encoded, values[i] - predict(previous[i], beforePrevious[i]));
+        }
+        beforePrevious.swap(previous);
+    }
+    previous = values;
+
+    file.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+    offset += encoded.size();
+    header.tickCount++;
+    if (!file) failed.store(true);
+}
+
+bool StateReplayWriter::close() {
+    if (!thread.joinable()) return !failed.load();
+    stopping.store(true, std::memory_order_release);
+    thread.join();
+
+    header.indexOffset = offset;
+    file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(uint64_t)));
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    if (!file || failed.load()) {
+        std::cerr << "Unable to write state replay" << std::endl;
+        failed.store(true);
+        return false;
+    }
+    return true;
+}
+
+
+bool StateReplayReader::open(const std::string& path) {
+    if (!file.open(path)) {
+        std::cerr << "Unable to open state replay " << path << std::endl;
+        return false;
+    }
+    if (file.size() < sizeof(header)) {
+        std::cerr << "State replay " << path << " is truncated" << std::endl;
+        file.close();
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != STATE_REPLAY_MAGIC || header.version != STATE_REPLAY_VERSION || header.carCount == 0
+        || header.keyframeInterval == 0 || !(header.step > 0.0)) {
+        std::cerr << "State replay " << path << " has an unknown format" << std::endl;
+        file.close();
+        return false;
+    }
+    uint64_t keyframes = (header.tickCount + header.keyframeInterval - 1) / header.keyframeInterval;
+    if (header.tickCount == 0 || header.indexOffset < sizeof(header) || header.indexOffset > file.size()
+        || keyframes > (file.size() - header.indexOffset) / sizeof(uint64_t)) {
+        std::cerr << "State replay " << path << " is truncated" << std::endl;
+        file.close();
+        return false;
+    }
+
+    framesEnd = file.data() + header.indexOffset;
+    size_t values = 1 + header.carCount * 3;
+    current.resize(values);
+    previous.resize(values);
+    beforePrevious.resize(values);
+    decoded.cars.resize(header.carCount);
+    return seek(0);
+}
+
+bool StateReplayReader::decodeKeyframe(uint64_t keyframe) {
+    uint64_t frameOffset;
+    std::memcpy(&frameOffset, framesEnd + keyframe * sizeof(uint64_t), sizeof(frameOffset));
+    size_t bytes = current.size() * sizeof(int64_t);
+    if (frameOffset < sizeof(header) || frameOffset > header.indexOffset || header.indexOffset - frameOffset < bytes) {
+        return false;
+    }
+    std::memcpy(current.data(), file.data() + frameOffset, bytes);
+    cursor = file.data() + frameOffset + bytes;
+    previous = current;
+    beforePrevious = current;
+    return true;
+}
+
+bool StateReplayReader::decodeDelta() {
+    for (size_t i = 0; i < current.size(); i++) {
+        int64_t residual;
+        if (!readVarint(cursor, framesEnd, residual)) return false;
+        current[i] = static_cast<int64_t>(static_cast<uint64_t>(predict(previous[i], beforePrevious[i]))
+                                          + static_cast<uint64_t>(residual));
+    }
+    beforePrevious.swap(previous);
+    previous = current;
+    return true;
+}
+
+void StateReplayReader::publish(uint64_t tick) {
+    decoded.tick = tick;
+    decoded.winner = static_cast<int>(current[0]);
+    for (size_t i = 0; i < decoded.cars.size(); i++) {
+        decoded.cars[i] = { dequantize(current[1 + i * 3]), dequantize(current[2 + i * 3]),
+                            dequantize(current[3 + i * 3]) };
+    }
+}
+
+bool StateReplayReader::seek(uint64_t tick) {
+    if (!file.isOpen() || tick >= header.tickCount) return false;
+    if (!decodeKeyframe(tick / header.keyframeInterval)) {
+        std::cerr << "State replay has a broken keyframe at tick " << tick << std::endl;
+        return false;
+    }
+    for (uint64_t i = 0; i < tick % header.keyframeInterval; i++) {
+        if (!decodeDelta()) {
+            std::cerr << "State replay is broken at tick " << tick << std::endl;
+            return false;
+        }
+    }
+    publish(tick);
+    return true;
+}
+
+bool StateReplayReader::next() {
+    uint64_t tick = decoded.tick + 1;
+    if (!file.isOpen() || tick >= header.tickCount) return false;
+    //Keyframes are read directly, the cursor may sit anywhere when the frames before were skipped
+    if (tick % header.keyframeInterval == 0) return seek(tick);
+    if (!decodeDelta()) {
+        std::cerr << "State replay is broken at tick " << tick << std::endl;
+        return false;
+    }
+    publish(tick);
+    return true;
+}
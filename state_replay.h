@@ -0,0 +1,139 @@
+#ifndef MYGAME_STATE_REPLAY_H
+#define MYGAME_STATE_REPLAY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "simulation.h"
+#include "spsc_queue.h"
+
+
+//State replay file layout, little endian:
+//  StateReplayHeader, then one frame per tick, then the file offset of every keyframe.
+//  Every value is quantized to an integer: positions and angles in 1/256 pixel and degree,
+//  plus the winner. The first frame and every keyframeInterval-th frame after it are
+//  keyframes holding the values as int64. The frames in between hold, for each value,
+//  the zigzag LEB128 difference from a linear prediction out of the two frames before,
+//  so cars moving steadily cost about a byte per value.
+//Unlike an input replay it shows any tick without stepping the simulation up to it.
+constexpr uint32_t STATE_REPLAY_MAGIC = 0x5052534D; // "MSRP"
+constexpr uint32_t STATE_REPLAY_VERSION = 1;
+constexpr double STATE_REPLAY_SCALE = 256.0;
+
+struct StateReplayHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t carCount;
+    uint32_t keyframeInterval;
+    //Seconds per tick the race was recorded with
+    double step;
+    uint64_t tickCount;
+    //Where the keyframe offsets start, filled in when the replay is closed
+    uint64_t indexOffset;
+};
+
+//Where a car was on one tick, after quantizing
+struct CarPose {
+    double x;
+    double y;
+    double angle;
+};
+
+struct StateReplayFrame {
+    uint64_t tick = 0;
+    int winner = -1;
+    std::vector<CarPose> cars;
+};
+
+//Streams the state of every tick to disk. record() only quantizes the cars into a
+//ring buffer, a writer thread encodes the frames and does the file I/O.
+class StateReplayWriter {
+
+private:
+    //Winner first, then x, y and angle of every car
+    struct QueuedFrame {
+        std::vector<int64_t> values;
+    };
+
+    SpscQueue<QueuedFrame, 1024> queue;
+    QueuedFrame staging;
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> failed{false};
+
+    //Writer thread only
+    std::ofstream file;
+    StateReplayHeader header = {};
+    std::vector<uint64_t> index;
+    uint64_t offset = 0;
+    std::vector<int64_t> previous;
+    std::vector<int64_t> beforePrevious;
+    std::vector<uint8_t> encoded;
+    QueuedFrame frame;
+
+    void run();
+    void encode(const QueuedFrame& queued);
+
+public:
+
+    StateReplayWriter() = default;
+    ~StateReplayWriter();
+
+    StateReplayWriter(const StateReplayWriter&) = delete;
+    StateReplayWriter& operator=(const StateReplayWriter&) = delete;
+
+    bool open(const std::string& path, size_t carCount, double step, uint32_t keyframeInterval = 240);
+
+    //Call once per tick from one thread, starting with the state before the first step.
+    //Waits for the writer thread only when the ring buffer is full.
+    void record(const Simulation& simulation);
+
+    //Writes the remaining frames and the keyframe index, false if anything failed to write
+    bool close();
+
+    bool isOpen() const { return thread.joinable(); }
+};
+
+//Reads a state replay through a memory mapping. Seeking finds the keyframe at or before
+//the tick in the index and decodes at most keyframeInterval - 1 frames from there.
+class StateReplayReader {
+
+private:
+    MappedFile file;
+    StateReplayHeader header = {};
+    const uint8_t* framesEnd = nullptr;
+    const uint8_t* cursor = nullptr;
+    std::vector<int64_t> current;
+    std::vector<int64_t> previous;
+    std::vector<int64_t> beforePrevious;
+    StateReplayFrame decoded;
+
+    bool decodeKeyframe(uint64_t keyframe);
+    bool decodeDelta();
+    void publish(uint64_t tick);
+
+public:
+
+    bool open(const std::string& path);
+
+    //Moves to a tick before getTickCount(), false for ticks outside the replay
+    bool seek(uint64_t tick);
+
+    //Moves to the next tick, false at the end
+    bool next();
+
+    const StateReplayFrame& frame() const { return decoded; }
+
+    size_t getCarCount() const { return header.carCount; }
+    double getStep() const { return header.step; }
+    uint64_t getTickCount() const { return header.tickCount; }
+    size_t getFileSize() const { return file.size(); }
+};
+
+#endif //MYGAME_STATE_REPLAY_H
@@ -0,0 +1,81 @@
+#include "sweep.h"
+#include "job_system.h"
+#include "profiler.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+
+namespace {
+
+//Uniform in [low, high) from an LCG state
+double sampleRange(uint32_t& state, double low, double high) {
+    state = state * 1664525u + 1013904223u;
+    return low + (high - low) * ((state >> 8) / 16777216.0);
+}
+
+}
+
+
+PhysicsParameters samplePhysics(uint32_t seed, int race) {
+    uint32_t state = seed ^ (static_cast<uint32_t>(race) * 2654435761u);
+    PhysicsParameters physics;
+    physics.acceleration = sampleRange(state, 40.0, 60.0);
+    physics.surfaceDamping[static_cast<int>(Surface::Road)] = sampleRange(state, 0.98, 0.995);
+    physics.wallRestitution = sampleRange(state, 0.3, 0.7);
+    return physics;
+}
+
+std::vector<SweepRace> runSweep(const SweepOptions& sweep, const HeadlessOptions& options,
+                                std::shared_ptr<const TrackMap> track) {
+    std::vector<SweepRace> races(sweep.races > 0 ? sweep.races : 0);
+    for (size_t race = 0; race < races.size(); race++) {
+        races[race].physics = samplePhysics(options.seed, static_cast<int>(race));
+        races[race].seed = options.seed + static_cast<uint32_t>(race) * 7919u;
+    }
+
+    //Races vary a lot in length, whole races are the jobs and idle workers steal them
+    JobSystem jobs(sweep.threads);
+    for (size_t race = 0; race < races.size(); race++) {
+        jobs.submit([&races, &options, &track, race] {
+            MYGAME_PROFILE_ZONE("Sweep race");
+            SweepRace& entry = races[race];
+            entry.result = runRace(options, track, entry.seed, entry.physics);
+        });
+    }
+    jobs.wait();
+    return races;
+}
+
+bool writeSweepCsv(const std::string& path, const std::vector<SweepRace>& races) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Unable to write sweep results " << path << std::endl;
+        return false;
+    }
+
+    file << "race,seed,acceleration,road_damping,wall_restitution,finished,winner,ticks,finish_time,best_lap,collisions,checksum,order\n";
+    for (size_t race = 0; race < races.size(); race++) {
+        const SweepRace& entry = races[race];
+        const RaceResult& result = entry.result;
+        file << race << ',' << entry.seed << ','
+             << std::setprecision(6) << entry.physics.acceleration << ','
+             << entry.physics.surfaceDamping[static_cast<int>(Surface::Road)] << ','
+             << entry.physics.wallRestitution << ','
+             << (result.finished ? 1 : 0) << ',' << result.winner << ','
+             << result.ticks << ',' << result.finishTime << ',' << result.bestLap << ','
+             << result.collisions << ','
+             << std::hex << result.checksum << std::dec << ',';
+        //Car indices separated by spaces so the column stays one CSV field
+        for (size_t i = 0; i < result.order.size(); i++) {
+            file << (i > 0 ? " " : "") << result.order[i];
+        }
+        file << '\n';
+    }
+    if (!file) {
+        std::cerr << "Unable to write sweep results " << path << std::endl;
+        return false;
+    }
+    return true;
+}
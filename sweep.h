@@ -0,0 +1,38 @@
+#ifndef MYGAME_SWEEP_H
+#define MYGAME_SWEEP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+#include "track_map.h"
+
+
+struct SweepOptions {
+    int races = 64;
+    //Threads running races, 0 uses every core
+    size_t threads = 0;
+};
+
+//One race of a sweep: the physics it was run with and how it went
+struct SweepRace {
+    PhysicsParameters physics;
+    uint32_t seed = 0;
+    RaceResult result;
+};
+
+//Parameters of race i in a sweep, drawn from the base seed so a sweep can be rerun
+PhysicsParameters samplePhysics(uint32_t seed, int race);
+
+//Runs sweep.races races with sampled physics, each race a job on a work stealing pool.
+//Results are stored by race index, so the output does not depend on the thread count.
+std::vector<SweepRace> runSweep(const SweepOptions& sweep, const HeadlessOptions& options,
+                                std::shared_ptr<const TrackMap> track);
+
+//One row per race: parameters, the winner's finish time, the best lap and the finishing order
+bool writeSweepCsv(const std::string& path, const std::vector<SweepRace>& races);
+
+#endif //MYGAME_SWEEP_H
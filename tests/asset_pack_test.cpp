@@ -0,0 +1,107 @@
+#include "check.h"
+#include "asset_pack.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+
+const char* const CAR_IMAGE = "resources/car1.bmp";
+const char* const TRACK_IMAGE = "resources/track.bmp";
+
+std::vector<uint8_t> readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+//Writes bytes to a scratch pack and tries to open it
+bool opens(const std::vector<uint8_t>& bytes) {
+    std::string path = testFilePath("broken.pack");
+    writeFile(path, bytes);
+    AssetPack pack;
+    bool result = pack.open(path);
+    std::remove(path.c_str());
+    return result;
+}
+
+PackEntry* entryAt(std::vector<uint8_t>& bytes, size_t index) {
+    return reinterpret_cast<PackEntry*>(bytes.data() + sizeof(PackHeader) + index * sizeof(PackEntry));
+}
+
+void testRoundTrip(const std::string& path) {
+    AssetPack pack;
+    CHECK(pack.open(path));
+    CHECK(pack.getEntryCount() == 2);
+
+    for (const char* name : { CAR_IMAGE, TRACK_IMAGE }) {
+        SDL_Surface* bmp = SDL_LoadBMP(name);
+        CHECK(bmp != nullptr);
+        PackedImage image;
+        CHECK(pack.find(name, image));
+        if (bmp == nullptr) continue;
+        CHECK(image.width == bmp->w && image.height == bmp->h);
+        CHECK(image.pitch >= image.width * 4);
+        //Pixel data is aligned for direct uploads
+        CHECK(reinterpret_cast<uintptr_t>(image.pixels) % 16 == 0);
+        SDL_FreeSurface(bmp);
+    }
+
+    PackedImage missing;
+    CHECK(!pack.find("resources/none.bmp", missing));
+}
+
+void testBrokenPacksAreRejected(const std::string& path) {
+    const std::vector<uint8_t> good = readFile(path);
+    CHECK(opens(good));
+
+    CHECK(!opens({}));
+    CHECK(!opens(std::vector<uint8_t>(good.begin(), good.begin() + sizeof(PackHeader) - 1)));
+    //Index cut off
+    CHECK(!opens(std::vector<uint8_t>(good.begin(), good.begin() + sizeof(PackHeader) + sizeof(PackEntry))));
+    //Pixels of the last image cut off
+    CHECK(!opens(std::vector<uint8_t>(good.begin(), good.end() - 4)));
+
+    std::vector<uint8_t> bytes = good;
+    reinterpret_cast<PackHeader*>(bytes.data())->magic ^= 1;
+    CHECK(!opens(bytes));
+
+    bytes = good;
+    reinterpret_cast<PackHeader*>(bytes.data())->version = PACK_VERSION + 1;
+    CHECK(!opens(bytes));
+
+    bytes = good;
+    reinterpret_cast<PackHeader*>(bytes.data())->entryCount = 0x7FFFFFFF;
+    CHECK(!opens(bytes));
+
+    bytes = good;
+    entryAt(bytes, 1)->offset = good.size() + 16;
+    CHECK(!opens(bytes));
+
+    bytes = good;
+    entryAt(bytes, 0)->pitch = entryAt(bytes, 0)->width * 4 - 4;
+    CHECK(!opens(bytes));
+
+    bytes = good;
+    entryAt(bytes, 0)->height = 0x7FFFFFFF;
+    CHECK(!opens(bytes));
+
+    bytes = good;
+    std::memset(entryAt(bytes, 0)->name, 'a', PACK_NAME_LENGTH);
+    CHECK(!opens(bytes));
+}
+
+int main() {
+    std::string path = testFilePath("test.pack");
+    CHECK(writeAssetPack(path, { CAR_IMAGE, TRACK_IMAGE }));
+    testRoundTrip(path);
+    testBrokenPacksAreRejected(path);
+    std::remove(path.c_str());
+    return checkResult();
+}
@@ -0,0 +1,79 @@
+#include "check.h"
+#include "broadphase.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+//Every overlapping pair, found the slow way
+std::vector<CollisionPair> bruteForcePairs(const std::vector<SDL_Rect>& boxes) {
+    std::vector<CollisionPair> pairs;
+    for (uint32_t a = 0; a < boxes.size(); a++) {
+        for (uint32_t b = a + 1; b < boxes.size(); b++) {
+            if (SDL_HasIntersection(&boxes[a], &boxes[b])) pairs.push_back({ a, b });
+        }
+    }
+    return pairs;
+}
+
+bool samePairs(std::vector<CollisionPair> found, std::vector<CollisionPair> expected) {
+    auto less = [](const CollisionPair& x, const CollisionPair& y) { return x.a != y.a ? x.a < y.a : x.b < y.b; };
+    std::sort(found.begin(), found.end(), less);
+    std::sort(expected.begin(), expected.end(), less);
+    if (found.size() != expected.size()) return false;
+    for (size_t i = 0; i < found.size(); i++) {
+        if (found[i].a != expected[i].a || found[i].b != expected[i].b) return false;
+    }
+    return true;
+}
+
+void testNothingToPair() {
+    SweepAndPrune broadphase;
+    std::vector<CollisionPair> pairs = { { 0, 1 } };
+    broadphase.findPairs({}, pairs);
+    CHECK(pairs.empty());
+    broadphase.findPairs({ { 0, 0, 10, 10 } }, pairs);
+    CHECK(pairs.empty());
+}
+
+void testTouchingEdgesDoNotPair() {
+    //Same rule as SDL_HasIntersection: sharing an edge is not an overlap
+    SweepAndPrune broadphase;
+    std::vector<CollisionPair> pairs;
+    broadphase.findPairs({ { 0, 0, 10, 10 }, { 10, 0, 10, 10 }, { 0, 10, 10, 10 } }, pairs);
+    CHECK(pairs.empty());
+    broadphase.findPairs({ { 0, 0, 10, 10 }, { 9, 9, 10, 10 } }, pairs);
+    CHECK(pairs.size() == 1);
+}
+
+void testMatchesBruteForceWhileMoving() {
+    //The sort order carries over between calls, so move the boxes a little every tick like cars do
+    TestRandom random(7);
+    std::vector<SDL_Rect> boxes(300);
+    for (SDL_Rect& box : boxes) {
+        box.x = static_cast<int>(random.next() % 800);
+        box.y = static_cast<int>(random.next() % 600);
+        box.w = 20 + static_cast<int>(random.next() % 30);
+        box.h = 20 + static_cast<int>(random.next() % 30);
+    }
+
+    SweepAndPrune broadphase;
+    std::vector<CollisionPair> pairs;
+    for (int tick = 0; tick < 50; tick++) {
+        broadphase.findPairs(boxes, pairs);
+        for (const CollisionPair& pair : pairs) CHECK(pair.a < pair.b);
+        CHECK(samePairs(pairs, bruteForcePairs(boxes)));
+        for (SDL_Rect& box : boxes) {
+            box.x += static_cast<int>(random.next() % 7) - 3;
+            box.y += static_cast<int>(random.next() % 7) - 3;
+        }
+    }
+}
+
+int main() {
+    testNothingToPair();
+    testTouchingEdgesDoNotPair();
+    testMatchesBruteForceWhileMoving();
+    return checkResult();
+}
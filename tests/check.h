@@ -0,0 +1,50 @@
+#ifndef MYGAME_TESTS_CHECK_H
+#define MYGAME_TESTS_CHECK_H
+
+//The tests have their own main, SDL must not rename it
+#define SDL_MAIN_HANDLED
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+
+//Minimal checks for the test executables. A failed check prints where it failed and the
+//test carries on; main returns checkResult() so ctest sees the failure.
+inline int& checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            checkFailures()++; \
+        } \
+    } while (0)
+
+inline int checkResult() {
+    if (checkFailures() > 0) std::cerr << checkFailures() << " checks failed" << std::endl;
+    return checkFailures() > 0 ? 1 : 0;
+}
+
+//Scratch file for a test, in the system temp directory
+inline std::string testFilePath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("mygame_" + name)).string();
+}
+
+//Same LCG as the stress runs, so failures reproduce
+struct TestRandom {
+    uint32_t state;
+
+    explicit TestRandom(uint32_t seed) : state(seed) {}
+
+    uint32_t next() {
+        state = state * 1664525u + 1013904223u;
+        return state >> 16;
+    }
+};
+
+#endif //MYGAME_TESTS_CHECK_H
@@ -0,0 +1,114 @@
+#include "check.h"
+#include "car_pool.h"
+#include "fixed_point.h"
+
+#include <cmath>
+
+
+void testConversions() {
+    CHECK(Fixed::fromInt(3).raw == 3 * Fixed::ONE);
+    CHECK(Fixed::fromInt(-2).toDouble() == -2.0);
+    CHECK(Fixed::fromDouble(0.5).raw == Fixed::ONE / 2);
+    CHECK(Fixed::fromDouble(-1.25).toDouble() == -1.25);
+    //Rounds to the nearest step
+    CHECK(Fixed::fromDouble(1.0 / 3.0).raw == 21845);
+    CHECK(Fixed::fromDouble(-1.0 / 3.0).raw == -21845);
+}
+
+void testWrapping() {
+    Fixed largest = Fixed::fromRaw(INT32_MAX);
+    Fixed smallest = Fixed::fromRaw(INT32_MIN);
+    Fixed step = Fixed::fromRaw(1);
+    CHECK((largest + step).raw == INT32_MIN);
+    CHECK((smallest - step).raw == INT32_MAX);
+    CHECK((-smallest).raw == INT32_MIN);
+    Fixed sum = largest;
+    sum += step;
+    CHECK(sum == smallest);
+}
+
+void testMultiplication() {
+    CHECK(Fixed::fromInt(3) * Fixed::fromInt(-4) == Fixed::fromInt(-12));
+    CHECK(Fixed::fromDouble(1.5) * Fixed::fromDouble(2.5) == Fixed::fromDouble(3.75));
+    //The lost bits round towards minus infinity, so a tiny negative product is one step below zero
+    Fixed step = Fixed::fromRaw(1);
+    CHECK((step * step).raw == 0);
+    CHECK((-step * step).raw == -1);
+    CHECK((Fixed::fromRaw(3) * Fixed::fromDouble(0.5)).raw == 1);
+    CHECK((Fixed::fromRaw(-3) * Fixed::fromDouble(0.5)).raw == -2);
+}
+
+void testDivision() {
+    CHECK(Fixed::fromInt(7) / Fixed::fromInt(2) == Fixed::fromDouble(3.5));
+    CHECK(Fixed::fromInt(-9) / Fixed::fromInt(3) == Fixed::fromInt(-3));
+    CHECK(Fixed::fromInt(1) / Fixed::fromInt(3) == Fixed::fromRaw(21845));
+
+    Fixed zero;
+    CHECK((Fixed::fromInt(5) / zero).raw == INT32_MAX);
+    CHECK((Fixed::fromRaw(1) / zero).raw == INT32_MAX);
+    CHECK((Fixed::fromInt(-5) / zero).raw == INT32_MIN);
+    CHECK((zero / zero).raw == 0);
+    //Also usable in constant expressions
+    static_assert((Fixed::fromInt(1) / Fixed()).raw == INT32_MAX, "division by zero saturates");
+}
+
+void testSinCos() {
+    //Table rounding plus the short series stay within a few steps
+    const double tolerance = 4.0 / Fixed::ONE;
+    for (double degrees = -725.0; degrees <= 725.0; degrees += 0.37) {
+        Fixed s;
+        Fixed c;
+        fixedSinCosDegrees(Fixed::fromDouble(degrees), s, c);
+        Fixed angle = Fixed::fromDouble(degrees);
+        double radians = angle.toDouble() * DEGREES_TO_RADIANS;
+        CHECK(std::fabs(s.toDouble() - std::sin(radians)) < tolerance);
+        CHECK(std::fabs(c.toDouble() - std::cos(radians)) < tolerance);
+    }
+}
+
+void testExp() {
+    for (double x : { -3.0, -1.0, std::log(0.99), 0.0, 0.5, 2.0 }) {
+        double expected = std::exp(x);
+        CHECK(std::fabs(fixedExp(Fixed::fromDouble(x)).toDouble() - expected) < 1e-3 * (1.0 + expected));
+    }
+    CHECK(fixedExp(Fixed()) == Fixed::fromInt(1));
+}
+
+void testLog() {
+    //The surface drag factors, below and above one and across several powers of two
+    for (double x : { 0.25, 0.9, 0.97, 0.99, 1.0, 1.5, 2.0, 3.0, 1000.0 }) {
+        CHECK(std::fabs(fixedLog(Fixed::fromDouble(x)).toDouble() - std::log(x)) < 1e-3);
+    }
+    CHECK(fixedLog(Fixed::fromInt(1)) == Fixed());
+    //No logarithm at zero or below
+    CHECK(fixedLog(Fixed()).raw == INT32_MIN);
+    CHECK(fixedLog(Fixed::fromInt(-2)).raw == INT32_MIN);
+    //Per tick drag taken back to the drag per 60th of a second
+    Fixed damping = Fixed::fromDouble(0.99);
+    CHECK(std::fabs(fixedExp(fixedLog(damping)).toDouble() - 0.99) < 1e-3);
+}
+
+void testPoolIsIdenticalAtEverySimdLevel() {
+    //An odd count so the vector kernels also run their scalar tails
+    const size_t cars = 37;
+    StressResult scalar = runCarPoolStress<Fixed>(cars, 300, 1.0 / 60.0, SimdLevel::Scalar);
+    CHECK(scalar.cars == cars);
+    CHECK(scalar.checksum != 0);
+    for (SimdLevel level : { SimdLevel::SSE2, SimdLevel::AVX2 }) {
+        if (detectSimdLevel() < level) continue;
+        StressResult vector = runCarPoolStress<Fixed>(cars, 300, 1.0 / 60.0, level);
+        CHECK(vector.checksum == scalar.checksum);
+    }
+}
+
+int main() {
+    testConversions();
+    testWrapping();
+    testMultiplication();
+    testDivision();
+    testSinCos();
+    testExp();
+    testLog();
+    testPoolIsIdenticalAtEverySimdLevel();
+    return checkResult();
+}
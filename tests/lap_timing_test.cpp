@@ -0,0 +1,104 @@
+#include "check.h"
+#include "lap_timing.h"
+#include "simulation.h"
+#include "track_layout.h"
+
+#include <cmath>
+
+
+//Two lines crossed to the right, 50 pixels tall: the finish at x = 100 and a checkpoint at x = 200
+const std::vector<TimingLine> LINES = { { 100, 0, 100, 50 }, { 200, 0, 200, 50 } };
+
+bool near(double a, double b) {
+    return std::fabs(a - b) < 1e-9;
+}
+
+//Moves a car at height y across x = line - 5 to line + 5 during the tick from start to start + 0.1
+bool cross(const LapTimer& timer, CarTiming& timing, double line, double start, double y = 25) {
+    return timer.update(timing, line - 5, y, line + 5, y, start, 0.1);
+}
+
+void testCrossings() {
+    LapTimer timer(LINES);
+    CarTiming timing;
+
+    //Backwards, outside the segment and missing the line do not count
+    CHECK(!timer.update(timing, 105, 25, 95, 25, 0.0, 0.1));
+    CHECK(!cross(timer, timing, 100, 0.0, 60));
+    CHECK(!timer.update(timing, 80, 25, 95, 25, 0.0, 0.1));
+    CHECK(!timing.started);
+
+    //The first crossing starts the lap, timed halfway through the tick
+    CHECK(!cross(timer, timing, 100, 1.0));
+    CHECK(timing.started);
+    CHECK(near(timing.lapStart, 1.05));
+    CHECK(timing.nextLine == 1);
+
+    //Only the next line counts, crossing the finish again is ignored
+    CHECK(!cross(timer, timing, 100, 1.5));
+    CHECK(near(timing.lastCrossing, 1.05));
+
+    CHECK(!cross(timer, timing, 200, 2.0));
+    CHECK(near(timing.sectors[0], 1.0));
+    CHECK(timing.nextLine == 0);
+
+    //The path ends exactly on the line: fraction 1, the end of the tick
+    CHECK(timer.update(timing, 90, 25, 100, 25, 3.0, 0.1));
+    CHECK(timing.lapsCompleted == 1);
+    CHECK(near(timing.lastLap, 2.05));
+    CHECK(near(timing.bestLap, 2.05));
+    CHECK(near(timing.lastLapSectors[1], 1.05));
+
+    //A faster lap becomes the best, a slower one does not
+    cross(timer, timing, 200, 3.5);
+    CHECK(cross(timer, timing, 100, 4.0));
+    CHECK(near(timing.lastLap, 0.95));
+    CHECK(near(timing.bestLap, 0.95));
+    cross(timer, timing, 200, 5.0);
+    CHECK(cross(timer, timing, 100, 7.0));
+    CHECK(near(timing.bestLap, 0.95));
+    CHECK(timing.lapsCompleted == 3);
+}
+
+void testRaceOrder() {
+    LapTimer timer(LINES);
+    CarTiming leader, follower, waiting;
+    cross(timer, leader, 100, 0.0);
+    cross(timer, follower, 100, 0.2);
+    //Same progress, the earlier crossing is ahead
+    CHECK(isAhead(leader, follower, LINES.size()));
+    CHECK(!isAhead(follower, leader, LINES.size()));
+    CHECK(isAhead(follower, waiting, LINES.size()));
+    CHECK(!isAhead(waiting, waiting, LINES.size()));
+
+    //More lines crossed beats an earlier crossing, also on the last sector of a lap
+    cross(timer, follower, 200, 1.0);
+    CHECK(isAhead(follower, leader, LINES.size()));
+    cross(timer, leader, 200, 1.5);
+    cross(timer, leader, 100, 2.0);
+    CHECK(leader.lapsCompleted == 1);
+    CHECK(isAhead(leader, follower, LINES.size()));
+}
+
+void testAiRaceIsWon() {
+    //AI drivers finish RACE_LAPS laps on the real track, the winner leads the order
+    std::shared_ptr<const TrackMap> track = loadTrackMap(createTrackLayout(1));
+    CHECK(track != nullptr);
+    if (!track) return;
+    HeadlessOptions options;
+    options.cars = 4;
+    options.aiDrivers = true;
+    options.maxTicks = 20000;
+    RaceResult result = runRace(options, track, 1, PhysicsParameters());
+    CHECK(result.finished);
+    CHECK(result.winner >= 0);
+    CHECK(!result.order.empty() && static_cast<int>(result.order[0]) == result.winner);
+    CHECK(result.bestLap > 0.0 && result.bestLap <= result.finishTime);
+}
+
+int main() {
+    testCrossings();
+    testRaceOrder();
+    testAiRaceIsWon();
+    return checkResult();
+}
@@ -0,0 +1,58 @@
+#include "check.h"
+#include "netcode.h"
+#include "track_layout.h"
+
+
+//Restoring a snapshot and stepping the same inputs again repeats the ticks bit for bit
+void testSaveAndRestore(std::shared_ptr<const TrackMap> track) {
+    HeadlessOptions options;
+    TrackLayout layout = createTrackLayout(1);
+    Simulation simulation(createStartingGrid(16, {}), track, PhysicsParameters(), layout.timingLines);
+    ScriptedDriver driver(3, options.dt);
+    std::vector<CarInput> inputs;
+    for (int tick = 0; tick < 600; tick++) inputs.push_back(driver.drive(static_cast<uint64_t>(tick)));
+    auto stepTo = [&](size_t tick) {
+        while (simulation.getTick() < tick) {
+            for (size_t car = 0; car < simulation.getCars().size(); car++) {
+                simulation.setInput(car, inputs[simulation.getTick()]);
+            }
+            simulation.step(options.dt);
+        }
+    };
+
+    stepTo(200);
+    SimulationState state;
+    simulation.saveState(state);
+    stepTo(600);
+    uint64_t expected = simulation.checksum();
+
+    simulation.restoreState(state);
+    CHECK(simulation.getTick() == 200);
+    CHECK(simulation.checksum() != expected);
+    stepTo(600);
+    CHECK(simulation.checksum() == expected);
+}
+
+//Both rollback sessions must end on the state of the race stepped with the real controls
+void testLoopbackRace(std::shared_ptr<const TrackMap> track, double latency, double lossRate, bool expectRollbacks) {
+    HeadlessOptions options;
+    options.maxTicks = 1200;
+    options.seed = 9;
+    NetplayResult result = runLoopbackRace(options, track, latency, lossRate);
+    CHECK(result.ticks > 0);
+    CHECK(result.inSync());
+    if (expectRollbacks) CHECK(result.stats[0].rollbacks > 0 && result.stats[1].rollbacks > 0);
+    if (lossRate > 0.0) CHECK(result.packetsLost > 0);
+}
+
+int main() {
+    std::shared_ptr<const TrackMap> track = loadTrackMap(createTrackLayout(1));
+    CHECK(track != nullptr);
+    if (!track) return checkResult();
+
+    testSaveAndRestore(track);
+    testLoopbackRace(track, 0.0, 0.0, false);
+    testLoopbackRace(track, 0.1, 0.0, true);
+    testLoopbackRace(track, 0.08, 0.2, true);
+    return checkResult();
+}
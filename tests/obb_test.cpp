@@ -0,0 +1,131 @@
+#include "check.h"
+#include "obb.h"
+
+#include <cmath>
+#include <vector>
+
+
+constexpr double HALF_SQRT2 = 0.70710678118654752;
+
+//A 40x20 box like a car facing right, rotated to the given unit axis
+OrientedBox carBox(double x, double y, double axisX = 1.0, double axisY = 0.0) {
+    return { x, y, axisX, axisY, 10.0, 20.0 };
+}
+
+Contact testPair(const OrientedBox& a, const OrientedBox& b, SimdLevel level, bool& touching) {
+    BoxPairBatch batch;
+    batch.add(a, b);
+    batch.test(level);
+    touching = batch.isTouching(0);
+    return batch.getContact(0);
+}
+
+bool near(double a, double b) {
+    return std::fabs(a - b) < 1e-9;
+}
+
+void testAlignedBoxes() {
+    bool touching;
+    //Overlapping by 5 along the length, the shallowest axis gives the normal from a to b
+    Contact contact = testPair(carBox(0, 0), carBox(35, 0), SimdLevel::Scalar, touching);
+    CHECK(touching);
+    CHECK(near(contact.depth, 5.0));
+    CHECK(near(contact.normalX, 1.0) && near(contact.normalY, 0.0));
+
+    contact = testPair(carBox(0, 0), carBox(-35, 0), SimdLevel::Scalar, touching);
+    CHECK(touching);
+    CHECK(near(contact.normalX, -1.0));
+
+    contact = testPair(carBox(0, 0), carBox(0, 15), SimdLevel::Scalar, touching);
+    CHECK(touching);
+    CHECK(near(contact.depth, 5.0));
+    CHECK(near(contact.normalX, 0.0) && near(contact.normalY, 1.0));
+
+    testPair(carBox(0, 0), carBox(41, 0), SimdLevel::Scalar, touching);
+    CHECK(!touching);
+    testPair(carBox(0, 0), carBox(0, 20), SimdLevel::Scalar, touching);
+    CHECK(!touching);
+}
+
+void testRotatedBoxes() {
+    bool touching;
+    //b turned 45 degrees reaches 21.2 down towards a, whose half height is 10
+    Contact contact = testPair(carBox(0, 0), carBox(0, 30, HALF_SQRT2, HALF_SQRT2), SimdLevel::Scalar, touching);
+    CHECK(touching);
+    CHECK(near(contact.depth, 10.0 + 30.0 * HALF_SQRT2 - 30.0));
+    CHECK(near(contact.normalY, 1.0));
+
+    testPair(carBox(0, 0), carBox(0, 32, HALF_SQRT2, HALF_SQRT2), SimdLevel::Scalar, touching);
+    CHECK(!touching);
+
+    //The bounding rects overlap here, only b's own axis separates the boxes
+    OrientedBox a = carBox(0, 0);
+    OrientedBox b = carBox(35, 28, HALF_SQRT2, HALF_SQRT2);
+    SDL_Rect boundsA = boundingRect(a);
+    SDL_Rect boundsB = boundingRect(b);
+    CHECK(SDL_HasIntersection(&boundsA, &boundsB));
+    testPair(a, b, SimdLevel::Scalar, touching);
+    CHECK(!touching);
+}
+
+void testSimdLevelsAgree() {
+    //Odd counts leave a scalar tail after the SSE2 and AVX2 loops
+    TestRandom random(11);
+    BoxPairBatch scalar;
+    BoxPairBatch vector;
+    for (int i = 0; i < 203; i++) {
+        double angleA = (random.next() % 360) * 3.14159265358979 / 180.0;
+        double angleB = (random.next() % 360) * 3.14159265358979 / 180.0;
+        OrientedBox a = carBox(random.next() % 100, random.next() % 100, std::cos(angleA), std::sin(angleA));
+        OrientedBox b = carBox(random.next() % 100, random.next() % 100, std::cos(angleB), std::sin(angleB));
+        scalar.add(a, b);
+        vector.add(a, b);
+    }
+    scalar.test(SimdLevel::Scalar);
+
+    for (SimdLevel level : { SimdLevel::SSE2, SimdLevel::AVX2 }) {
+        if (detectSimdLevel() < level) continue;
+        vector.test(level);
+        for (size_t i = 0; i < scalar.size(); i++) {
+            CHECK(scalar.isTouching(i) == vector.isTouching(i));
+            Contact expected = scalar.getContact(i);
+            Contact actual = vector.getContact(i);
+            //Bit for bit, the simulation must not depend on the machine it runs on
+            CHECK(expected.depth == actual.depth);
+            CHECK(expected.normalX == actual.normalX && expected.normalY == actual.normalY);
+        }
+    }
+}
+
+void testCoincidentCentres() {
+    //With the centres on top of each other the shallowest axis is (-1, -1) / sqrt(2), whose
+    //projection of the zero offset is -0.0. Every level has to treat that as positive.
+    OrientedBox box = carBox(50, 50, -HALF_SQRT2, HALF_SQRT2);
+    BoxPairBatch scalar;
+    BoxPairBatch vector;
+    for (int i = 0; i < 3; i++) {
+        scalar.add(box, box);
+        vector.add(box, box);
+    }
+    scalar.test(SimdLevel::Scalar);
+    CHECK(scalar.getContact(0).normalX == -HALF_SQRT2 && scalar.getContact(0).normalY == -HALF_SQRT2);
+
+    for (SimdLevel level : { SimdLevel::SSE2, SimdLevel::AVX2 }) {
+        if (detectSimdLevel() < level) continue;
+        vector.test(level);
+        for (size_t i = 0; i < scalar.size(); i++) {
+            Contact expected = scalar.getContact(i);
+            Contact actual = vector.getContact(i);
+            CHECK(expected.normalX == actual.normalX && expected.normalY == actual.normalY);
+            CHECK(expected.depth == actual.depth);
+        }
+    }
+}
+
+int main() {
+    testAlignedBoxes();
+    testRotatedBoxes();
+    testSimdLevelsAgree();
+    testCoincidentCentres();
+    return checkResult();
+}
@@ -0,0 +1,54 @@
+#include "check.h"
+#include "simulation.h"
+#include "track_layout.h"
+
+#include <cstdio>
+
+
+//Simulation::checksum after RACE_TICKS of the race below. A different value means the race
+//physics changed: make sure that was meant, record the new values here and bump
+//REPLAY_VERSION, recorded replays play a different race now. The fixed point value holds on
+//every compiler and machine, the double one was taken on x86-64 with glibc and may differ
+//with another C library's std::pow.
+#if defined(MYGAME_FIXED_POINT)
+constexpr uint64_t GOLDEN_CHECKSUM = 0xbb55958a0f97712dull;
+#else
+constexpr uint64_t GOLDEN_CHECKSUM = 0x32a420a096336fc0ull;
+#endif
+
+const size_t RACE_CARS = 12;
+const uint64_t RACE_TICKS = 3000;
+
+//Scripted drivers on the real track, enough cars that they hit the walls and each other
+uint64_t raceChecksum(SimdLevel level) {
+    TrackLayout layout = createTrackLayout(1);
+    Simulation simulation(createStartingGrid(RACE_CARS, {}), loadTrackMap(layout), PhysicsParameters(),
+                          layout.timingLines);
+    simulation.setSimdLevel(level);
+    HeadlessOptions options;
+    std::vector<ScriptedDriver> drivers;
+    for (size_t car = 0; car < RACE_CARS; car++) drivers.emplace_back(static_cast<uint32_t>(car + 7), options.dt);
+
+    uint64_t collisions = 0;
+    for (uint64_t tick = 0; tick < RACE_TICKS; tick++) {
+        for (size_t car = 0; car < RACE_CARS; car++) simulation.setInput(car, drivers[car].drive(tick));
+        simulation.step(options.dt);
+        collisions += simulation.getCollisionPairs().size();
+    }
+    //A race without contacts would leave resolveCollision out of the checksum
+    CHECK(collisions > 0);
+    return simulation.checksum();
+}
+
+int main() {
+    CHECK(loadTrackMap(createTrackLayout(1)) != nullptr);
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+        if (detectSimdLevel() < level) continue;
+        uint64_t checksum = raceChecksum(level);
+        if (checksum != GOLDEN_CHECKSUM) {
+            std::printf("%s race checksum %016llx\n", simdLevelName(level), static_cast<unsigned long long>(checksum));
+        }
+        CHECK(checksum == GOLDEN_CHECKSUM);
+    }
+    return checkResult();
+}
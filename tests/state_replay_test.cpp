@@ -0,0 +1,91 @@
+#include "check.h"
+#include "state_replay.h"
+#include "track_layout.h"
+
+#include <cmath>
+#include <cstdio>
+
+
+//Poses quantize to 1/256, so they come back within half a step
+bool matches(const CarPose& pose, const CarSnapshot& car) {
+    double tolerance = 0.5 / STATE_REPLAY_SCALE + 1e-9;
+    return std::fabs(pose.x - car.position.v.x) <= tolerance && std::fabs(pose.y - car.position.v.y) <= tolerance
+           && std::fabs(pose.angle - car.angle) <= tolerance;
+}
+
+bool matchesTick(const StateReplayReader& reader, const std::vector<std::vector<CarSnapshot>>& ticks,
+                 const std::vector<int>& winners, uint64_t tick) {
+    const StateReplayFrame& frame = reader.frame();
+    if (frame.tick != tick || frame.winner != winners[tick] || frame.cars.size() != ticks[tick].size()) return false;
+    for (size_t car = 0; car < frame.cars.size(); car++) {
+        if (!matches(frame.cars[car], ticks[tick][car])) return false;
+    }
+    return true;
+}
+
+int main() {
+    std::shared_ptr<const TrackMap> track = loadTrackMap(createTrackLayout(1));
+    CHECK(track != nullptr);
+    if (!track) return checkResult();
+
+    //A short keyframe interval puts many keyframes and partial runs of deltas in the file
+    const size_t cars = 12;
+    const uint32_t keyframeInterval = 16;
+    HeadlessOptions options;
+    Simulation simulation(createStartingGrid(cars, {}), track, PhysicsParameters(), createTrackLayout(1).timingLines);
+    std::vector<ScriptedDriver> drivers;
+    for (size_t car = 0; car < cars; car++) drivers.emplace_back(static_cast<uint32_t>(car + 1), options.dt);
+
+    std::string path = testFilePath("state.srp");
+    StateReplayWriter writer;
+    CHECK(writer.open(path, cars, options.dt, keyframeInterval));
+
+    //What the replay should show, the state before the first step included
+    std::vector<std::vector<CarSnapshot>> ticks;
+    std::vector<int> winners;
+    auto capture = [&] {
+        ticks.emplace_back();
+        for (size_t i = 0; i < simulation.getCars().size(); i++) ticks.back().push_back(simulation.snapshot(i));
+        winners.push_back(simulation.getWinner());
+        writer.record(simulation);
+    };
+    capture();
+    for (uint64_t tick = 0; tick < 1000; tick++) {
+        for (size_t car = 0; car < cars; car++) simulation.setInput(car, drivers[car].drive(tick));
+        simulation.step(options.dt);
+        capture();
+    }
+    CHECK(writer.close());
+
+    //Scoped so the mapping is gone before the file is removed
+    {
+        StateReplayReader reader;
+        CHECK(reader.open(path));
+        CHECK(reader.getCarCount() == cars);
+        CHECK(reader.getTickCount() == ticks.size());
+        CHECK(reader.getStep() == options.dt);
+
+        //Front to back
+        bool played = matchesTick(reader, ticks, winners, 0);
+        uint64_t frames = 1;
+        while (reader.next()) {
+            played = played && matchesTick(reader, ticks, winners, frames);
+            frames++;
+        }
+        CHECK(played);
+        CHECK(frames == ticks.size());
+
+        //Seeking lands on keyframes, just before and after them and back to the start
+        bool sought = true;
+        TestRandom random(3);
+        std::vector<uint64_t> targets = { 0, keyframeInterval - 1, keyframeInterval, keyframeInterval + 1, ticks.size() - 1 };
+        for (int i = 0; i < 200; i++) targets.push_back(random.next() % ticks.size());
+        for (uint64_t tick : targets) {
+            sought = sought && reader.seek(tick) && matchesTick(reader, ticks, winners, tick);
+        }
+        CHECK(sought);
+        CHECK(!reader.seek(ticks.size()));
+    }
+    std::remove(path.c_str());
+    return checkResult();
+}
@@ -0,0 +1,113 @@
+#include "check.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
+
+#include <cstdint>
+#include <thread>
+
+
+//Two fields written separately, a torn read would see them disagree
+struct Pair {
+    uint64_t value = 0;
+    uint64_t twice = 0;
+};
+
+void testTripleBufferInOneThread() {
+    TripleBuffer<Pair> buffer;
+    CHECK(!buffer.update());
+
+    buffer.writeBuffer() = { 1, 2 };
+    buffer.publish();
+    CHECK(buffer.update());
+    CHECK(buffer.readBuffer().value == 1);
+    CHECK(!buffer.update());
+    CHECK(buffer.readBuffer().value == 1);
+
+    //Only the newest of several publishes reaches the reader
+    for (uint64_t i = 2; i <= 4; i++) {
+        buffer.writeBuffer() = { i, i * 2 };
+        buffer.publish();
+    }
+    CHECK(buffer.update());
+    CHECK(buffer.readBuffer().value == 4);
+}
+
+void testTripleBufferAcrossThreads() {
+    const uint64_t last = 200000;
+    TripleBuffer<Pair> buffer;
+    std::thread writer([&buffer, last] {
+        for (uint64_t i = 1; i <= last; i++) {
+            buffer.writeBuffer() = { i, i * 2 };
+            buffer.publish();
+        }
+    });
+
+    //The reader never sees a half written slot or an older value after a newer one
+    uint64_t seen = 0;
+    bool consistent = true;
+    while (seen < last) {
+        if (!buffer.update()) continue;
+        const Pair& pair = buffer.readBuffer();
+        consistent = consistent && pair.twice == pair.value * 2 && pair.value > seen;
+        seen = pair.value;
+    }
+    writer.join();
+    CHECK(consistent);
+    CHECK(seen == last);
+}
+
+void testQueueInOneThread() {
+    SpscQueue<int, 8> queue;
+    int item = -1;
+    CHECK(!queue.pop(item));
+
+    for (int i = 0; i < 8; i++) CHECK(queue.push(i));
+    CHECK(!queue.push(8));
+    for (int i = 0; i < 8; i++) {
+        CHECK(queue.pop(item));
+        CHECK(item == i);
+    }
+    CHECK(!queue.pop(item));
+
+    //Indices keep counting past the capacity
+    for (int i = 0; i < 20; i++) {
+        CHECK(queue.push(i));
+        CHECK(queue.pop(item));
+        CHECK(item == i);
+    }
+}
+
+void testQueueAcrossThreads() {
+    const uint64_t count = 500000;
+    SpscQueue<uint64_t, 64> queue;
+    std::thread producer([&queue, count] {
+        for (uint64_t i = 0; i < count; i++) {
+            while (!queue.push(i)) std::this_thread::yield();
+        }
+    });
+
+    //Every item arrives once and in order
+    bool inOrder = true;
+    uint64_t expected = 0;
+    while (expected < count) {
+        uint64_t item;
+        if (!queue.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        inOrder = inOrder && item == expected;
+        expected++;
+    }
+    producer.join();
+    CHECK(inOrder);
+    uint64_t extra;
+    CHECK(!queue.pop(extra));
+}
+
+int main() {
+    testTripleBufferInOneThread();
+    testTripleBufferAcrossThreads();
+    testQueueInOneThread();
+    testQueueAcrossThreads();
+    return checkResult();
+}
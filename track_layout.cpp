@@ -0,0 +1,27 @@
+#include "track_layout.h"
+
+#include <algorithm>
+
+
+TrackLayout createTrackLayout(int scale) {
+    TrackLayout layout;
+    layout.scale = std::min(std::max(scale, 1), MAX_TRACK_SCALE);
+    layout.width = WINDOW_WIDTH * layout.scale;
+    layout.height = WINDOW_HEIGHT * layout.scale;
+    for (TimingLine line : TRACK_TIMING_LINES) {
+        layout.timingLines.push_back({ line.x0 * layout.scale, line.y0 * layout.scale,
+                                       line.x1 * layout.scale, line.y1 * layout.scale });
+    }
+    for (Waypoint waypoint : TRACK_WAYPOINTS) {
+        layout.waypoints.push_back({ waypoint.x * layout.scale, waypoint.y * layout.scale });
+    }
+    return layout;
+}
+
+std::shared_ptr<const TrackMap> loadTrackMap(const TrackLayout& layout) {
+    auto track = std::make_shared<TrackMap>();
+    if (!track->load("resources/track_mask.bmp", TRACK_MASK_PALETTE, layout.width, layout.height, 4 * layout.scale)) {
+        return nullptr;
+    }
+    return track;
+}
@@ -0,0 +1,33 @@
+#ifndef MYGAME_TRACK_LAYOUT_H
+#define MYGAME_TRACK_LAYOUT_H
+
+#include <memory>
+#include <vector>
+
+#include "ai_driver.h"
+#include "car.h"
+#include "lap_timing.h"
+#include "track_map.h"
+
+
+constexpr int MAX_TRACK_SCALE = 16;
+
+//Where everything on the track is, in world pixels. The track is drawn for the window;
+//scaling it up makes a world several windows large with the same corners, while the
+//cars keep their size, so a lap gets longer and the camera has to follow the players.
+struct TrackLayout {
+    int scale = 1;
+    int width = WINDOW_WIDTH;
+    int height = WINDOW_HEIGHT;
+    std::vector<TimingLine> timingLines;
+    std::vector<Waypoint> waypoints;
+};
+
+//scale is clamped to [1, MAX_TRACK_SCALE]
+TrackLayout createTrackLayout(int scale);
+
+//Walls and surfaces of the layout baked from the track mask. Cells grow with the scale,
+//so the map takes the same memory at any size.
+std::shared_ptr<const TrackMap> loadTrackMap(const TrackLayout& layout);
+
+#endif //MYGAME_TRACK_LAYOUT_H
@@ -0,0 +1,251 @@
+#include "track_map.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+
+const std::vector<SurfaceColor> TRACK_MASK_PALETTE = {
+        {128, 128, 128, Surface::Road},
+        {255, 0, 0, Surface::Curb},
+        {0, 160, 0, Surface::Grass},
+        {0, 0, 0, Surface::Wall}
+};
+
+namespace {
+
+Surface closestSurface(Uint8 r, Uint8 g, Uint8 b, const std::vector<SurfaceColor>& palette) {
+    Surface best = Surface::Road;
+    int bestDistance = std::numeric_limits<int>::max();
+    for (const SurfaceColor& color : palette) {
+        int dr = r - color.r;
+        int dg = g - color.g;
+        int db = b - color.b;
+        int distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = color.surface;
+        }
+    }
+    return best;
+}
+
+//One dimensional squared distance transform (Felzenszwalb and Huttenlocher)
+void distanceTransform1D(const float* f, float* d, int n, int* v, float* z) {
+    const float inf = std::numeric_limits<float>::infinity();
+    int k = 0;
+    v[0] = 0;
+    z[0] = -inf;
+    z[1] = inf;
+    for (int q = 1; q < n; q++) {
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+        while (s <= z[k]) {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = inf;
+    }
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q) k++;
+        d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
+
+//Squared distance in cells from every cell to the closest cell where inside is true
+std::vector<float> squaredDistances(const std::vector<bool>& inside, int columns, int rows) {
+    const float inf = 1e20f;
+    int longest = columns > rows ? columns : rows;
+    std::vector<float> grid(inside.size());
+    std::vector<float> f(longest), d(longest), z(longest + 1);
+    std::vector<int> v(longest);
+
+    for (size_t i = 0; i < inside.size(); i++) grid[i] = inside[i] ? 0.0f : inf;
+
+    for (int x = 0; x < columns; x++) {
+        for (int y = 0; y < rows; y++) f[y] = grid[y * columns + x];
+        distanceTransform1D(f.data(), d.data(), rows, v.data(), z.data());
+        for (int y = 0; y < rows; y++) grid[y * columns + x] = d[y];
+    }
+    for (int y = 0; y < rows; y++) {
+        distanceTransform1D(&grid[y * columns], d.data(), columns, v.data(), z.data());
+        for (int x = 0; x < columns; x++) grid[y * columns + x] = d[x];
+    }
+    return grid;
+}
+
+}
+
+
+bool TrackMap::load(const std::string& path, const std::vector<SurfaceColor>& palette, int width, int height, int cellSize) {
+    SDL_Surface* loadedSurface = SDL_LoadBMP(path.c_str());
+    if (loadedSurface == nullptr) {
+        std::cerr << "Unable to load track map " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    SDL_Surface* image = SDL_ConvertSurfaceFormat(loadedSurface, SDL_PIXELFORMAT_RGB888, 0);
+    SDL_FreeSurface(loadedSurface);
+    if (image == nullptr) {
+        std::cerr << "Unable to convert track map " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    this->cellSize = cellSize;
+    this->width = width;
+    this->height = height;
+    columns = (width + cellSize - 1) / cellSize;
+    rows = (height + cellSize - 1) / cellSize;
+    surfaces.assign(static_cast<size_t>(columns) * rows, static_cast<uint8_t>(Surface::Road));
+
+    //Each cell takes the surface of the image pixel under its centre
+    SDL_LockSurface(image);
+    for (int y = 0; y < rows; y++) {
+        int imageY = static_cast<int>((y + 0.5) * cellSize * image->h / height);
+        if (imageY >= image->h) imageY = image->h - 1;
+        const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(image->pixels) + imageY * image->pitch);
+        for (int x = 0; x < columns; x++) {
+            int imageX = static_cast<int>((x + 0.5) * cellSize * image->w / width);
+            if (imageX >= image->w) imageX = image->w - 1;
+            Uint32 pixel = row[imageX];
+            Surface surface = closestSurface((pixel >> 16) & 0xFF, (pixel >> 8) & 0xFF, pixel & 0xFF, palette);
+            surfaces[y * columns + x] = static_cast<uint8_t>(surface);
+        }
+    }
+    SDL_UnlockSurface(image);
+    SDL_FreeSurface(image);
+
+    bakeDistanceField();
+    return true;
+}
+
+void TrackMap::bakeDistanceField() {
+    std::vector<bool> walls(surfaces.size());
+    std::vector<bool> open(surfaces.size());
+    for (size_t i = 0; i < surfaces.size(); i++) {
+        walls[i] = surfaces[i] == static_cast<uint8_t>(Surface::Wall);
+        open[i] = !walls[i];
+    }
+    std::vector<float> toWall = squaredDistances(walls, columns, rows);
+    std::vector<float> toOpen = squaredDistances(open, columns, rows);
+
+    //Distances are between cell centres, the wall edge sits half a cell in between
+    distances.resize(surfaces.size());
+    for (size_t i = 0; i < surfaces.size(); i++) {
+        float cells = walls[i] ? -(std::sqrt(toOpen[i]) - 0.5f) : std::sqrt(toWall[i]) - 0.5f;
+        distances[i] = cells * cellSize;
+    }
+
+    //Normals follow the gradient of the distance field
+    normalsX.resize(surfaces.size());
+    normalsY.resize(surfaces.size());
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < columns; x++) {
+            int left = x > 0 ? x - 1 : x;
+            int right = x < columns - 1 ? x + 1 : x;
+            int up = y > 0 ? y - 1 : y;
+            int down = y < rows - 1 ? y + 1 : y;
+            float gx = distances[y * columns + right] - distances[y * columns + left];
+            float gy = distances[down * columns + x] - distances[up * columns + x];
+            float length = std::sqrt(gx * gx + gy * gy);
+            normalsX[y * columns + x] = length > 0.0f ? gx / length : 0.0f;
+            normalsY[y * columns + x] = length > 0.0f ? gy / length : 0.0f;
+        }
+    }
+}
+
+TrackSample TrackMap::sample(double x, double y) const {
+    TrackSample result = { std::numeric_limits<double>::max(), 0.0, 0.0, Surface::Road };
+    if (columns == 0) return result;
+
+    //Bilinear interpolation between the four closest cell centres
+    double gx = x / cellSize - 0.5;
+    double gy = y / cellSize - 0.5;
+    int x0 = static_cast<int>(std::floor(gx));
+    int y0 = static_cast<int>(std::floor(gy));
+    double fx = gx - x0;
+    double fy = gy - y0;
+    int x1 = x0 + 1;
+    int y1 = y0 + 1;
+    //Points more than a cell outside the grid, like the corners of a car at the window edge, use the edge cells
+    x0 = std::min(std::max(x0, 0), columns - 1);
+    y0 = std::min(std::max(y0, 0), rows - 1);
+    x1 = std::min(std::max(x1, 0), columns - 1);
+    y1 = std::min(std::max(y1, 0), rows - 1);
+
+    int i00 = y0 * columns + x0;
+    int i10 = y0 * columns + x1;
+    int i01 = y1 * columns + x0;
+    int i11 = y1 * columns + x1;
+    double w00 = (1 - fx) * (1 - fy);
+    double w10 = fx * (1 - fy);
+    double w01 = (1 - fx) * fy;
+    double w11 = fx * fy;
+
+    result.distance = distances[i00] * w00 + distances[i10] * w10 + distances[i01] * w01 + distances[i11] * w11;
+    double nx = normalsX[i00] * w00 + normalsX[i10] * w10 + normalsX[i01] * w01 + normalsX[i11] * w11;
+    double ny = normalsY[i00] * w00 + normalsY[i10] * w10 + normalsY[i01] * w01 + normalsY[i11] * w11;
+    double length = std::sqrt(nx * nx + ny * ny);
+    if (length > 0.0) {
+        result.normalX = nx / length;
+        result.normalY = ny / length;
+    }
+    result.surface = surfaceAt(x, y);
+    return result;
+}
+
+Surface TrackMap::surfaceAt(double x, double y) const {
+    int cx = static_cast<int>(x) / cellSize;
+    int cy = static_cast<int>(y) / cellSize;
+    if (x < 0 || y < 0 || cx >= columns || cy >= rows) return Surface::Road;
+    return static_cast<Surface>(surfaces[cy * columns + cx]);
+}
+
+bool TrackMap::sweep(double x0, double y0, double x1, double y1, double& timeOfImpact, double& normalX, double& normalY) const {
+    if (columns == 0) return false;
+
+    int cx = static_cast<int>(std::floor(x0 / cellSize));
+    int cy = static_cast<int>(std::floor(y0 / cellSize));
+    auto isWall = [this](int x, int y) {
+        return x >= 0 && y >= 0 && x < columns && y < rows && surfaces[y * columns + x] == static_cast<uint8_t>(Surface::Wall);
+    };
+    if (isWall(cx, cy)) return false;
+
+    //Grid traversal (Amanatides and Woo): tMax is the fraction of the segment at which
+    //the next vertical or horizontal cell border is crossed
+    const double inf = std::numeric_limits<double>::infinity();
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    int stepX = dx > 0 ? 1 : (dx < 0 ? -1 : 0);
+    int stepY = dy > 0 ? 1 : (dy < 0 ? -1 : 0);
+    double tDeltaX = stepX != 0 ? cellSize / std::fabs(dx) : inf;
+    double tDeltaY = stepY != 0 ? cellSize / std::fabs(dy) : inf;
+    double tMaxX = stepX > 0 ? ((cx + 1) * cellSize - x0) / dx : (stepX < 0 ? (cx * cellSize - x0) / dx : inf);
+    double tMaxY = stepY > 0 ? ((cy + 1) * cellSize - y0) / dy : (stepY < 0 ? (cy * cellSize - y0) / dy : inf);
+
+    while (true) {
+        double t;
+        if (tMaxX < tMaxY) {
+            t = tMaxX;
+            cx += stepX;
+            tMaxX += tDeltaX;
+            normalX = -stepX;
+            normalY = 0.0;
+        } else {
+            t = tMaxY;
+            cy += stepY;
+            tMaxY += tDeltaY;
+            normalX = 0.0;
+            normalY = -stepY;
+        }
+        if (t > 1.0) return false;
+        if (cx < -1 || cy < -1 || cx > columns || cy > rows) return false;
+        if (isWall(cx, cy)) {
+            timeOfImpact = t;
+            return true;
+        }
+    }
+}
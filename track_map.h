@@ -0,0 +1,84 @@
+#ifndef MYGAME_TRACK_MAP_H
+#define MYGAME_TRACK_MAP_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+enum class Surface : uint8_t {
+    Road,
+    Curb,
+    Grass,
+    Wall
+};
+
+constexpr int SURFACE_COUNT = 4;
+
+//Share of the velocity kept per 60 Hz tick on each surface
+constexpr double SURFACE_DAMPING[SURFACE_COUNT] = { 0.99, 0.985, 0.97, 0.99 };
+
+//Image colour that marks a surface, pixels take the surface of the closest colour
+struct SurfaceColor {
+    Uint8 r;
+    Uint8 g;
+    Uint8 b;
+    Surface surface;
+};
+
+//Colours used by resources/track_mask.bmp
+extern const std::vector<SurfaceColor> TRACK_MASK_PALETTE;
+
+struct TrackSample {
+    //Signed distance in pixels to the closest wall edge, negative inside a wall
+    double distance;
+    //Unit vector pointing away from the closest wall
+    double normalX;
+    double normalY;
+    Surface surface;
+};
+
+//Collision and surface grid baked once from an image stretched over the window,
+//with a signed distance field so every query is a constant time lookup no matter
+//how many walls the track has
+class TrackMap {
+
+private:
+    int cellSize = 4;
+    int width = 0;
+    int height = 0;
+    int columns = 0;
+    int rows = 0;
+    std::vector<uint8_t> surfaces;
+    std::vector<float> distances;
+    std::vector<float> normalsX;
+    std::vector<float> normalsY;
+
+    void bakeDistanceField();
+
+public:
+
+    //Builds the grid for a width x height pixel area covered by the image at path
+    bool load(const std::string& path, const std::vector<SurfaceColor>& palette, int width, int height, int cellSize = 4);
+
+    //Distance, smooth normal and surface at a point in window pixels
+    TrackSample sample(double x, double y) const;
+
+    Surface surfaceAt(double x, double y) const;
+
+    //Walks the segment from (x0, y0) to (x1, y1) through the grid and reports the first
+    //wall cell it enters: time of impact in [0, 1] and the normal of the face it crossed.
+    //Segments starting inside a wall are left to the distance field.
+    bool sweep(double x0, double y0, double x1, double y1, double& timeOfImpact, double& normalX, double& normalY) const;
+
+    //Size of the area the map covers in pixels
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    int getColumns() const { return columns; }
+    int getRows() const { return rows; }
+    int getCellSize() const { return cellSize; }
+};
+
+#endif //MYGAME_TRACK_MAP_H
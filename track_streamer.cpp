@@ -0,0 +1,207 @@
+#include "track_streamer.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <iostream>
+
+
+TrackStreamer::TrackStreamer(SDL_Renderer* renderer, std::string imagePath, SDL_Texture* placeholder,
+                             int worldWidth, int worldHeight, int viewWidth, int viewHeight, int chunkSize)
+    : renderer(renderer), imagePath(std::move(imagePath)), placeholder(placeholder), worldWidth(worldWidth),
+      worldHeight(worldHeight), chunkSize(chunkSize), columns((worldWidth + chunkSize - 1) / chunkSize),
+      rows((worldHeight + chunkSize - 1) / chunkSize) {
+    //A view not aligned to the chunks touches one more of them each way, the margin adds two
+    int viewColumns = (viewWidth + chunkSize - 1) / chunkSize + 3;
+    int viewRows = (viewHeight + chunkSize - 1) / chunkSize + 3;
+    //Only textures that were created join the pool, an empty slot would always look least recently used
+    int poolSize = std::min(viewColumns * viewRows, columns * rows);
+    for (int i = 0; i < poolSize; i++) {
+        Slot slot;
+        slot.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, chunkSize, chunkSize);
+        if (slot.texture == nullptr) {
+            std::cerr << "Unable to create track chunk texture! SDL Error: " << SDL_GetError() << std::endl;
+            break;
+        }
+        slots.push_back(slot);
+    }
+    chunkSlots.assign(static_cast<size_t>(columns) * rows, -1);
+    worker = std::thread(&TrackStreamer::workerLoop, this);
+}
+
+TrackStreamer::~TrackStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+
+    for (FinishedChunk& chunk : finished) {
+        if (chunk.surface) SDL_FreeSurface(chunk.surface);
+    }
+    for (Slot& slot : slots) {
+        if (slot.texture) SDL_DestroyTexture(slot.texture);
+    }
+}
+
+SDL_Rect TrackStreamer::chunkRect(int chunk) const {
+    int x = (chunk % columns) * chunkSize;
+    int y = (chunk / columns) * chunkSize;
+    return { x, y, std::min(chunkSize, worldWidth - x), std::min(chunkSize, worldHeight - y) };
+}
+
+void TrackStreamer::workerLoop() {
+    //The image is read here so constructing the streamer never waits on the disk
+    SDL_Surface* source = nullptr;
+    SDL_Surface* loaded = SDL_LoadBMP(imagePath.c_str());
+    if (loaded == nullptr) {
+        std::cerr << "Unable to load track image " << imagePath << "! SDL Error: " << SDL_GetError() << std::endl;
+    } else {
+        source = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(loaded);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !requests.empty(); });
+        if (stopping) break;
+        int chunk = requests.front();
+        requests.erase(requests.begin());
+        inProgress.push_back(chunk);
+
+        lock.unlock();
+        SDL_Surface* surface = source ? makeChunk(source, chunk) : nullptr;
+        lock.lock();
+
+        inProgress.erase(std::find(inProgress.begin(), inProgress.end(), chunk));
+        finished.push_back({ chunk, surface });
+    }
+
+    if (source) SDL_FreeSurface(source);
+}
+
+SDL_Surface* TrackStreamer::makeChunk(const SDL_Surface* source, int chunk) const {
+    MYGAME_PROFILE_ZONE("Make track chunk");
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, chunkSize, chunkSize, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (surface == nullptr) return nullptr;
+
+    //Nearest pixel, the same sampling SDL_RenderCopy uses to stretch the whole image
+    SDL_Rect rect = chunkRect(chunk);
+    for (int y = 0; y < rect.h; y++) {
+        int sourceY = std::min(static_cast<int>(static_cast<int64_t>(rect.y + y) * source->h / worldHeight), source->h - 1);
+        const Uint32* sourceRow = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(source->pixels) + sourceY * source->pitch);
+        Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels) + y * surface->pitch);
+        for (int x = 0; x < rect.w; x++) {
+            int sourceX = std::min(static_cast<int>(static_cast<int64_t>(rect.x + x) * source->w / worldWidth), source->w - 1);
+            row[x] = sourceRow[sourceX];
+        }
+    }
+    return surface;
+}
+
+void TrackStreamer::addWanted(const SDL_Rect& area) {
+    int firstColumn = std::max(0, area.x / chunkSize);
+    int firstRow = std::max(0, area.y / chunkSize);
+    int lastColumn = std::min(columns - 1, (area.x + area.w - 1) / chunkSize);
+    int lastRow = std::min(rows - 1, (area.y + area.h - 1) / chunkSize);
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            int chunk = row * columns + column;
+            if (std::find(wanted.begin(), wanted.end(), chunk) == wanted.end()) wanted.push_back(chunk);
+        }
+    }
+}
+
+void TrackStreamer::upload(FinishedChunk& chunk) {
+    if (chunk.surface == nullptr) return;
+    if (slots.empty()) {
+        SDL_FreeSurface(chunk.surface);
+        return;
+    }
+    if (chunkSlots[chunk.chunk] < 0) {
+        //The least recently used slot, never one drawn this frame
+        size_t oldest = 0;
+        for (size_t i = 1; i < slots.size(); i++) {
+            if (slots[i].lastUsed < slots[oldest].lastUsed) oldest = i;
+        }
+        Slot& slot = slots[oldest];
+        if (slot.lastUsed == frame) {
+            SDL_FreeSurface(chunk.surface);
+            return;
+        }
+        if (slot.chunk >= 0) chunkSlots[slot.chunk] = -1;
+        slot.chunk = chunk.chunk;
+        chunkSlots[chunk.chunk] = static_cast<int>(oldest);
+        SDL_UpdateTexture(slot.texture, nullptr, chunk.surface->pixels, chunk.surface->pitch);
+        chunksLoaded++;
+    }
+    slots[chunkSlots[chunk.chunk]].lastUsed = frame;
+    SDL_FreeSurface(chunk.surface);
+}
+
+void TrackStreamer::update(const SDL_Rect& view, const std::vector<SDL_Point>& focus) {
+    MYGAME_PROFILE_ZONE("Track streaming");
+    frame++;
+
+    //Visible chunks first, then a ring of one chunk around the view, then what lies ahead
+    //of the cars, as long as the pool has room for it
+    wanted.clear();
+    addWanted(view);
+    addWanted({ view.x - chunkSize, view.y - chunkSize, view.w + 2 * chunkSize, view.h + 2 * chunkSize });
+    for (const SDL_Point& point : focus) {
+        addWanted({ point.x - chunkSize / 2, point.y - chunkSize / 2, chunkSize, chunkSize });
+    }
+    if (wanted.size() > slots.size()) wanted.resize(slots.size());
+
+    for (int chunk : wanted) {
+        if (chunkSlots[chunk] >= 0) slots[chunkSlots[chunk]].lastUsed = frame;
+    }
+
+    std::vector<FinishedChunk> arrived;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        arrived.swap(finished);
+        requests.clear();
+        for (int chunk : wanted) {
+            bool pending = chunkSlots[chunk] >= 0
+                           || std::find(inProgress.begin(), inProgress.end(), chunk) != inProgress.end()
+                           || std::any_of(arrived.begin(), arrived.end(), [chunk](const FinishedChunk& done) { return done.chunk == chunk; });
+            if (!pending) requests.push_back(chunk);
+        }
+    }
+    if (!requests.empty()) wake.notify_one();
+
+    for (FinishedChunk& chunk : arrived) upload(chunk);
+}
+
+int TrackStreamer::draw(const SDL_Rect& view) {
+    MYGAME_PROFILE_ZONE("Draw track chunks");
+    int placeholderWidth = 0;
+    int placeholderHeight = 0;
+    if (placeholder) SDL_QueryTexture(placeholder, nullptr, nullptr, &placeholderWidth, &placeholderHeight);
+
+    int calls = 0;
+    int firstColumn = std::max(0, view.x / chunkSize);
+    int firstRow = std::max(0, view.y / chunkSize);
+    int lastColumn = std::min(columns - 1, (view.x + view.w - 1) / chunkSize);
+    int lastRow = std::min(rows - 1, (view.y + view.h - 1) / chunkSize);
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            int chunk = row * columns + column;
+            SDL_Rect rect = chunkRect(chunk);
+            SDL_Rect destination = { rect.x - view.x, rect.y - view.y, rect.w, rect.h };
+            if (chunkSlots[chunk] >= 0) {
+                SDL_Rect source = { 0, 0, rect.w, rect.h };
+                SDL_RenderCopy(renderer, slots[chunkSlots[chunk]].texture, &source, &destination);
+                calls++;
+            } else if (placeholder) {
+                SDL_Rect source = { rect.x * placeholderWidth / worldWidth, rect.y * placeholderHeight / worldHeight,
+                                    std::max(1, rect.w * placeholderWidth / worldWidth),
+                                    std::max(1, rect.h * placeholderHeight / worldHeight) };
+                SDL_RenderCopy(renderer, placeholder, &source, &destination);
+                calls++;
+            }
+        }
+    }
+    return calls;
+}
@@ -0,0 +1,92 @@
+#ifndef MYGAME_TRACK_STREAMER_H
+#define MYGAME_TRACK_STREAMER_H
+
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+//Draws a track world larger than the window from square chunks. A worker thread cuts
+//the chunks around the view and around the points the cars are heading for out of the
+//track image scaled to the world; the render thread uploads them into a fixed pool of
+//textures and evicts the least recently used ones. Texture memory and draw calls depend
+//on the window size only, never on the size of the world.
+//Every method must be called from the thread that owns the renderer.
+class TrackStreamer {
+
+private:
+    struct FinishedChunk {
+        int chunk;
+        //Null when the chunk could not be made
+        SDL_Surface* surface;
+    };
+
+    struct Slot {
+        SDL_Texture* texture = nullptr;
+        int chunk = -1;
+        uint64_t lastUsed = 0;
+    };
+
+    SDL_Renderer* renderer;
+    std::string imagePath;
+    //Low resolution stand-in drawn where a chunk has not arrived yet, may be null
+    SDL_Texture* placeholder;
+    int worldWidth;
+    int worldHeight;
+    int chunkSize;
+    int columns;
+    int rows;
+
+    std::vector<Slot> slots;
+    //Slot index of every chunk, -1 while it is not resident
+    std::vector<int> chunkSlots;
+    uint64_t frame = 0;
+    std::vector<int> wanted;
+    uint64_t chunksLoaded = 0;
+
+    //Shared with the worker
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    //Chunks to make, most important first, replaced every frame
+    std::vector<int> requests;
+    std::vector<int> inProgress;
+    std::vector<FinishedChunk> finished;
+    bool stopping = false;
+
+    void workerLoop();
+    SDL_Surface* makeChunk(const SDL_Surface* source, int chunk) const;
+    SDL_Rect chunkRect(int chunk) const;
+    void addWanted(const SDL_Rect& area);
+    void upload(FinishedChunk& chunk);
+
+public:
+
+    //The pool holds enough chunks for a view of viewWidth x viewHeight plus a ring of
+    //chunks around it, fewer if the renderer runs out of textures. The image is stretched
+    //over the whole world.
+    TrackStreamer(SDL_Renderer* renderer, std::string imagePath, SDL_Texture* placeholder,
+                  int worldWidth, int worldHeight, int viewWidth, int viewHeight, int chunkSize = 256);
+    ~TrackStreamer();
+
+    TrackStreamer(const TrackStreamer&) = delete;
+    TrackStreamer& operator=(const TrackStreamer&) = delete;
+
+    //Uploads the chunks the worker has finished and asks for the ones around the view and
+    //around each focus point that are missing. Call once per frame before draw().
+    void update(const SDL_Rect& view, const std::vector<SDL_Point>& focus);
+
+    //Draws the part of the world inside view at the top left of the window, returns
+    //the number of render calls it took
+    int draw(const SDL_Rect& view);
+
+    size_t getPoolSize() const { return slots.size(); }
+    uint64_t getChunksLoaded() const { return chunksLoaded; }
+};
+
+#endif //MYGAME_TRACK_STREAMER_H
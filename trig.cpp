@@ -0,0 +1,116 @@
+#include "trig.h"
+
+
+namespace {
+
+void sinCosScalar(const double* degrees, double* sines, double* cosines, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        sinCosDegrees(degrees[i], sines[i], cosines[i]);
+    }
+}
+
+#if defined(MYGAME_SSE2)
+size_t sinCosSSE2(const double* degrees, double* sines, double* cosines, size_t count) {
+    const __m128d magic = _mm_set1_pd(6755399441055744.0);
+    const __m128d fullTurn = _mm_set1_pd(360.0);
+    const __m128d toRadians = _mm_set1_pd(DEGREES_TO_RADIANS);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+    const double* tableSines = SIN_COS_TABLE.sines.data();
+    const double* tableCosines = SIN_COS_TABLE.cosines.data();
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        //Same steps as sinCosDegrees
+        __m128d angle = _mm_loadu_pd(degrees + i);
+        __m128d whole = _mm_sub_pd(_mm_add_pd(angle, magic), magic);
+        __m128d turns = _mm_sub_pd(_mm_add_pd(_mm_div_pd(whole, fullTurn), magic), magic);
+        __m128d index = _mm_sub_pd(whole, _mm_mul_pd(turns, fullTurn));
+        index = _mm_add_pd(index, _mm_and_pd(_mm_cmplt_pd(index, zero), fullTurn));
+
+        __m128d r = _mm_mul_pd(_mm_sub_pd(angle, whole), toRadians);
+        __m128d r2 = _mm_mul_pd(r, r);
+        __m128d rs = _mm_sub_pd(_mm_set1_pd(1.0 / 120.0), _mm_div_pd(r2, _mm_set1_pd(5040.0)));
+        rs = _mm_add_pd(_mm_set1_pd(-1.0 / 6.0), _mm_mul_pd(r2, rs));
+        rs = _mm_mul_pd(r, _mm_add_pd(one, _mm_mul_pd(r2, rs)));
+        __m128d rc = _mm_sub_pd(_mm_set1_pd(1.0 / 24.0), _mm_div_pd(r2, _mm_set1_pd(720.0)));
+        rc = _mm_add_pd(_mm_set1_pd(-0.5), _mm_mul_pd(r2, rc));
+        rc = _mm_add_pd(one, _mm_mul_pd(r2, rc));
+
+        //No gather before AVX2, the two table entries are loaded one at a time
+        __m128i lanes = _mm_cvttpd_epi32(index);
+        int i0 = _mm_cvtsi128_si32(lanes);
+        int i1 = _mm_cvtsi128_si32(_mm_shuffle_epi32(lanes, 1));
+        __m128d ts = _mm_set_pd(tableSines[i1], tableSines[i0]);
+        __m128d tc = _mm_set_pd(tableCosines[i1], tableCosines[i0]);
+
+        _mm_storeu_pd(sines + i, _mm_add_pd(_mm_mul_pd(ts, rc), _mm_mul_pd(tc, rs)));
+        _mm_storeu_pd(cosines + i, _mm_sub_pd(_mm_mul_pd(tc, rc), _mm_mul_pd(ts, rs)));
+    }
+    return i;
+}
+#endif
+
+#if defined(MYGAME_AVX2)
+MYGAME_TARGET_AVX2
+size_t sinCosAVX2(const double* degrees, double* sines, double* cosines, size_t count) {
+    const __m256d magic = _mm256_set1_pd(6755399441055744.0);
+    const __m256d fullTurn = _mm256_set1_pd(360.0);
+    const __m256d toRadians = _mm256_set1_pd(DEGREES_TO_RADIANS);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    const double* tableSines = SIN_COS_TABLE.sines.data();
+    const double* tableCosines = SIN_COS_TABLE.cosines.data();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d angle = _mm256_loadu_pd(degrees + i);
+        __m256d whole = _mm256_sub_pd(_mm256_add_pd(angle, magic), magic);
+        __m256d turns = _mm256_sub_pd(_mm256_add_pd(_mm256_div_pd(whole, fullTurn), magic), magic);
+        __m256d index = _mm256_sub_pd(whole, _mm256_mul_pd(turns, fullTurn));
+        index = _mm256_add_pd(index, _mm256_and_pd(_mm256_cmp_pd(index, zero, _CMP_LT_OQ), fullTurn));
+
+        __m256d r = _mm256_mul_pd(_mm256_sub_pd(angle, whole), toRadians);
+        __m256d r2 = _mm256_mul_pd(r, r);
+        __m256d rs = _mm256_sub_pd(_mm256_set1_pd(1.0 / 120.0), _mm256_div_pd(r2, _mm256_set1_pd(5040.0)));
+        rs = _mm256_add_pd(_mm256_set1_pd(-1.0 / 6.0), _mm256_mul_pd(r2, rs));
+        rs = _mm256_mul_pd(r, _mm256_add_pd(one, _mm256_mul_pd(r2, rs)));
+        __m256d rc = _mm256_sub_pd(_mm256_set1_pd(1.0 / 24.0), _mm256_div_pd(r2, _mm256_set1_pd(720.0)));
+        rc = _mm256_add_pd(_mm256_set1_pd(-0.5), _mm256_mul_pd(r2, rc));
+        rc = _mm256_add_pd(one, _mm256_mul_pd(r2, rc));
+
+        //The masked gather with a zero source, the plain one reads an uninitialised source in GCC's header
+        __m128i lanes = _mm256_cvttpd_epi32(index);
+        __m256d ts = _mm256_mask_i32gather_pd(zero, tableSines, lanes, allLanes, 8);
+        __m256d tc = _mm256_mask_i32gather_pd(zero, tableCosines, lanes, allLanes, 8);
+
+        _mm256_storeu_pd(sines + i, _mm256_add_pd(_mm256_mul_pd(ts, rc), _mm256_mul_pd(tc, rs)));
+        _mm256_storeu_pd(cosines + i, _mm256_sub_pd(_mm256_mul_pd(tc, rc), _mm256_mul_pd(ts, rs)));
+    }
+    return i;
+}
+#endif
+
+}
+
+
+void sinCosDegreesBatch(const double* degrees, double* sines, double* cosines, size_t count, SimdLevel level) {
+    size_t done = 0;
+    switch (level) {
+#if defined(MYGAME_AVX2)
+        case SimdLevel::AVX2:
+            done = sinCosAVX2(degrees, sines, cosines, count);
+            break;
+#endif
+#if defined(MYGAME_SSE2)
+        case SimdLevel::SSE2:
+            done = sinCosSSE2(degrees, sines, cosines, count);
+            break;
+#endif
+        default:
+            break;
+    }
+    //Angles left over after the last full vector
+    sinCosScalar(degrees, sines, cosines, done, count);
+}
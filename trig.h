@@ -0,0 +1,86 @@
+#ifndef MYGAME_TRIG_H
+#define MYGAME_TRIG_H
+
+#include <array>
+#include <cstddef>
+
+#include "simd.h"
+
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double DEGREES_TO_RADIANS = PI / 180.0;
+
+//Taylor series good to double precision for |x| <= pi / 2, only used to build the table
+constexpr double taylorSin(double x) {
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 12; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double taylorCos(double x) {
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 12; n++) {
+        term *= -x * x / ((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+//Sine and cosine of every whole degree, built at compile time
+struct SinCosTable {
+    std::array<double, 360> sines{};
+    std::array<double, 360> cosines{};
+};
+
+constexpr SinCosTable makeSinCosTable() {
+    SinCosTable table;
+    for (int degree = 0; degree < 360; degree++) {
+        //Fold into [-90, 90] where the series converges quickly
+        int folded = degree <= 90 ? degree : (degree < 270 ? 180 - degree : degree - 360);
+        double s = taylorSin(folded * DEGREES_TO_RADIANS);
+        double c = taylorCos(folded * DEGREES_TO_RADIANS);
+        table.sines[degree] = s;
+        table.cosines[degree] = degree > 90 && degree < 270 ? -c : c;
+    }
+    return table;
+}
+
+constexpr SinCosTable SIN_COS_TABLE = makeSinCosTable();
+
+//Sine and cosine of an angle within half a degree of zero
+inline void smallSinCos(double r, double& s, double& c) {
+    double r2 = r * r;
+    s = r * (1.0 + r2 * (-1.0 / 6.0 + r2 * (1.0 / 120.0 - r2 / 5040.0)));
+    c = 1.0 + r2 * (-0.5 + r2 * (1.0 / 24.0 - r2 / 720.0));
+}
+
+//Rounds to the closest integer (ties to even) with plain adds, the SIMD kernels use the
+//same trick so every level gives bit identical results. Valid for |x| < 2^51.
+inline double roundNearest(double x) {
+    const double magic = 6755399441055744.0;
+    return (x + magic) - magic;
+}
+
+//Table lookup for the closest whole degree, then the angle sum identities for the
+//remainder. Accurate to a few ulp with no calls into libm.
+inline void sinCosDegrees(double degrees, double& s, double& c) {
+    double whole = roundNearest(degrees);
+    double index = whole - roundNearest(whole / 360.0) * 360.0;
+    if (index < 0) index += 360.0;
+    double rs, rc;
+    smallSinCos((degrees - whole) * DEGREES_TO_RADIANS, rs, rc);
+    double ts = SIN_COS_TABLE.sines[static_cast<int>(index)];
+    double tc = SIN_COS_TABLE.cosines[static_cast<int>(index)];
+    s = ts * rc + tc * rs;
+    c = tc * rc - ts * rs;
+}
+
+//sinCosDegrees over whole arrays, two (SSE2) or four (AVX2) angles per instruction
+void sinCosDegreesBatch(const double* degrees, double* sines, double* cosines, size_t count, SimdLevel level);
+
+#endif //MYGAME_TRIG_H
@@ -0,0 +1,47 @@
+#ifndef MYGAME_TRIPLE_BUFFER_H
+#define MYGAME_TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+
+//Lock-free hand over of the latest value from one writer thread to one reader thread.
+//The writer fills its back slot and publishes it by swapping it with the middle slot;
+//the reader swaps the middle slot with its front slot when something new is there.
+//Neither side ever waits, the reader just keeps the last value until a newer one arrives.
+//Slots are reused, so a T holding vectors stops allocating once they have grown.
+template <typename T>
+class TripleBuffer {
+
+private:
+    static constexpr uint8_t INDEX_MASK = 3;
+    static constexpr uint8_t FRESH = 4;
+
+    T slots[3];
+    //Index of the middle slot, with FRESH set while the reader has not taken it
+    std::atomic<uint8_t> middle{1};
+    uint8_t back = 0;
+    uint8_t front = 2;
+
+public:
+
+    //Writer thread: the slot to fill for the next publish()
+    T& writeBuffer() { return slots[back]; }
+
+    //Writer thread: hands the filled slot to the reader
+    void publish() {
+        back = middle.exchange(static_cast<uint8_t>(back | FRESH), std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    //Reader thread: moves to the newest published value, false when there is none
+    bool update() {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    //Reader thread: the value taken by the last update()
+    const T& readBuffer() const { return slots[front]; }
+};
+
+#endif //MYGAME_TRIPLE_BUFFER_H
@@ -0,0 +1,71 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+
+WorkerPool::WorkerPool(size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void WorkerPool::runChunks() {
+    while (true) {
+        size_t begin = nextChunk.fetch_add(grain, std::memory_order_relaxed);
+        if (begin >= count) return;
+        size_t end = begin + grain < count ? begin + grain : count;
+        (*task)(begin, end);
+    }
+}
+
+void WorkerPool::workerLoop() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+
+        lock.unlock();
+        runChunks();
+        lock.lock();
+
+        if (--busyWorkers == 0) finished.notify_one();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& task) {
+    if (grain == 0) grain = 1;
+    if (workers.empty() || count <= grain) {
+        if (count > 0) task(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        this->count = count;
+        this->grain = grain;
+        nextChunk.store(0, std::memory_order_relaxed);
+        busyWorkers = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    runChunks();
+
+    //Workers may still be finishing their last chunk
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busyWorkers == 0; });
+    this->task = nullptr;
+}
@@ -0,0 +1,53 @@
+#ifndef MYGAME_WORKER_POOL_H
+#define MYGAME_WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//Persistent threads for data parallel passes over large arrays. parallelFor splits the
+//range into chunks that the workers and the calling thread claim from a shared counter,
+//so uneven chunks balance out. One pass runs at a time.
+class WorkerPool {
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    uint64_t generation = 0;
+    size_t busyWorkers = 0;
+    bool stopping = false;
+
+    //The current pass
+    const std::function<void(size_t, size_t)>* task = nullptr;
+    size_t count = 0;
+    size_t grain = 1;
+    std::atomic<size_t> nextChunk{0};
+
+    void workerLoop();
+    void runChunks();
+
+public:
+
+    //threads = 0 uses one thread per core, the caller counts as one of them
+    explicit WorkerPool(size_t threads = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    //Calls task(begin, end) over [0, count) in chunks of at most grain items and waits
+    //until all of them are done. Small ranges run on the calling thread only.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& task);
+
+    size_t getThreadCount() const { return workers.size() + 1; }
+};
+
+#endif //MYGAME_WORKER_POOL_H